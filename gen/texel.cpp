@@ -0,0 +1,447 @@
+/**
+ * Maxima, a chess playing program.
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *
+ * File:  texel.cpp
+ * Texel-style tuning of the evaluation: minimizes the logistic error between
+ * the evaluation of labelled positions and the game results, by local search
+ * over the piece square tables and the pawn and piece score terms.
+ *
+ * Usage: texel <dataset> [threads=cores] [qsearch=0] [rounds=100]
+ *
+ * Each line of the dataset holds a FEN followed by the game result, either
+ * as 1-0, 0-1, 1/2-1/2 or as [1.0], [0.5], [0.0] (white point of view).
+ * Positions are stored in a compact 36 byte format. Each thread owns one
+ * search object that is reused for all of its positions.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <iomanip>  //setw
+#include "bbmoves.h"
+#include "board.h"
+#include "search.h"
+#include "eval.h"
+#include "eval_pawns.h"
+#include "eval_pieces.h"
+#include "hashtable.h"
+#include "threadman.h"
+
+namespace texel {
+
+    const int FEN_SIZE = 96;
+    const double K_MIN = 0.5;
+    const double K_MAX = 2.5;
+
+    /**
+     * Compact labelled position: one nibble per square (a1..h8)
+     */
+    struct position_t {
+        uint8_t squares[32];
+        uint8_t castling;
+        int8_t enpassant_sq;
+        uint8_t wtm;
+        uint8_t result; //0: black wins, 1: draw, 2: white wins
+    };
+
+    struct param_t {
+        std::string name;
+        int16_t * value;
+        int min;
+        int max;
+        bool pawn_hash; //the term is cached in the pawn table
+    };
+
+    struct worker_t {
+        search_t * s;
+        game_t settings;
+        const position_t * first;
+        int count;
+        bool qsearch;
+        double k;
+        double error;
+        char fen[FEN_SIZE];
+    };
+
+    std::vector<position_t> positions;
+    std::vector<param_t> params;
+    worker_t workers[MAX_THREADS];
+    int worker_count = 1;
+    size_t first_score = 0; //index of the first score term parameter
+    pool_t pool;
+
+    inline int piece(const position_t & pos, int sq) {
+        return (pos.squares[sq >> 1] >> ((sq & 1) << 2)) & 15;
+    }
+
+    void pack(board_t * brd, int result, position_t & pos) {
+        memset(&pos, 0, sizeof (position_t));
+        for (int sq = a1; sq <= h8; sq++) {
+            pos.squares[sq >> 1] |= brd->matrix[sq] << ((sq & 1) << 2);
+        }
+        pos.castling = brd->stack->castling_flags;
+        pos.enpassant_sq = brd->stack->enpassant_sq;
+        pos.wtm = brd->stack->wtm;
+        pos.result = result;
+    }
+
+    /**
+     * Writes the position as FEN in a fixed buffer, so no memory is allocated
+     * @param pos the position
+     * @param fen buffer of at least FEN_SIZE characters
+     */
+    void unpack(const position_t & pos, char * fen) {
+        const char PIECENAME[13] = {'.', 'P', 'N', 'B', 'R', 'Q', 'K', 'p', 'n', 'b', 'r', 'q', 'k'};
+        char * p = fen;
+        for (int rank = 7; rank >= 0; rank--) {
+            int empty = 0;
+            for (int file = 0; file < 8; file++) {
+                int pc = piece(pos, rank * 8 + file);
+                if (pc == EMPTY) {
+                    empty++;
+                    continue;
+                }
+                if (empty) {
+                    *p++ = '0' + empty;
+                    empty = 0;
+                }
+                *p++ = PIECENAME[pc];
+            }
+            if (empty) {
+                *p++ = '0' + empty;
+            }
+            if (rank) {
+                *p++ = '/';
+            }
+        }
+        *p++ = ' ';
+        *p++ = pos.wtm ? 'w' : 'b';
+        *p++ = ' ';
+        if (pos.castling == 0) {
+            *p++ = '-';
+        }
+        if (pos.castling & CASTLE_K) {
+            *p++ = 'K';
+        }
+        if (pos.castling & CASTLE_Q) {
+            *p++ = 'Q';
+        }
+        if (pos.castling & CASTLE_k) {
+            *p++ = 'k';
+        }
+        if (pos.castling & CASTLE_q) {
+            *p++ = 'q';
+        }
+        *p++ = ' ';
+        if (pos.enpassant_sq) {
+            *p++ = 'a' + (pos.enpassant_sq & 7);
+            *p++ = '1' + (pos.enpassant_sq >> 3);
+        } else {
+            *p++ = '-';
+        }
+        strcpy(p, " 0 1");
+    }
+
+    /**
+     * Parses the game result of a dataset line
+     * @return 0 (black wins), 1 (draw), 2 (white wins) or -1 if not found
+     */
+    int parse_result(const std::string & line) {
+        if (line.find("1/2-1/2") != std::string::npos) {
+            return 1;
+        } else if (line.find("1-0") != std::string::npos) {
+            return 2;
+        } else if (line.find("0-1") != std::string::npos) {
+            return 0;
+        }
+        size_t bracket = line.find('[');
+        if (bracket != std::string::npos) {
+            return int(2 * atof(line.c_str() + bracket + 1) + 0.5);
+        }
+        return -1;
+    }
+
+    /**
+     * Loads the dataset. Positions in check are skipped, as they have no
+     * static evaluation.
+     */
+    bool load(const char * file_name, search_t * s) {
+        std::ifstream file(file_name);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::string line;
+        position_t pos;
+        while (std::getline(file, line)) {
+            int result = parse_result(line);
+            std::istringstream parser(line);
+            std::string field[4];
+            if (result < 0 || result > 2 || !(parser >> field[0] >> field[1] >> field[2] >> field[3])) {
+                continue;
+            }
+            std::string fen = field[0] + " " + field[1] + " " + field[2] + " " + field[3] + " 0 1";
+            s->brd.init(fen.c_str());
+            if (s->brd.in_check()) {
+                continue;
+            }
+            pack(&s->brd, result, pos);
+            positions.push_back(pos);
+            if (positions.size() % 1000000 == 0) {
+                std::cout << "." << std::flush;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Evaluation score of a position from white's point of view
+     */
+    int eval_white(worker_t * w, const position_t & pos) {
+        search_t * s = w->s;
+        unpack(pos, w->fen);
+        s->brd.init(w->fen);
+        s->reset_stack();
+        s->stack->in_check = s->brd.in_check();
+        s->stack->tt_key = s->brd.stack->tt_key;
+        int result = w->qsearch ? s->qsearch(-score::INF, score::INF, 0) : evaluate(s);
+        return pos.wtm ? result : -result;
+    }
+
+    void * eval_slice(void * worker_p) {
+        worker_t * w = (worker_t *) worker_p;
+        double error = 0;
+        for (const position_t * pos = w->first; pos != w->first + w->count; pos++) {
+            double sigmoid = 1.0 / (1.0 + pow(10.0, -w->k * eval_white(w, *pos) / 400.0));
+            double delta = pos->result / 2.0 - sigmoid;
+            error += delta * delta;
+        }
+        w->error = error;
+        return NULL;
+    }
+
+    /**
+     * Mean squared error of the dataset, evaluated by all threads
+     * @param k scaling constant
+     */
+    double error(double k) {
+        for (int i = 0; i < worker_count; i++) {
+            workers[i].k = k;
+            pool.start(i, eval_slice, &workers[i]);
+        }
+        pool.wait_all();
+        double result = 0;
+        for (int i = 0; i < worker_count; i++) {
+            result += workers[i].error;
+        }
+        return result / MAX(1, positions.size());
+    }
+
+    /**
+     * Scaling constant K that fits the current evaluation best (ternary search)
+     */
+    double find_k() {
+        double lo = K_MIN;
+        double hi = K_MAX;
+        while (hi - lo > 0.001) {
+            double m1 = lo + (hi - lo) / 3;
+            double m2 = hi - (hi - lo) / 3;
+            if (error(m1) < error(m2)) {
+                hi = m2;
+            } else {
+                lo = m1;
+            }
+        }
+        return (lo + hi) / 2;
+    }
+
+    /**
+     * White piece square tables mirror the black ones
+     */
+    void sync_pst() {
+        for (int sq = a1; sq <= h8; sq++) {
+            for (int pc = WPAWN; pc <= WKING; pc++) {
+                PST::table[pc][FLIP_SQUARE(sq)].set(PST::table[pc + 6][sq]);
+            }
+        }
+    }
+
+    void add_param(std::string name, int16_t * value, int min, int max, bool pawn_hash) {
+        param_t p = {name, value, min, max, pawn_hash};
+        params.push_back(p);
+    }
+
+    void add_score(std::string name, score_t * sc, bool pawn_hash) {
+        add_param(name + ".mg", &sc->mg, -500, 500, pawn_hash);
+        add_param(name + ".eg", &sc->eg, -500, 500, pawn_hash);
+    }
+
+    void init_params() {
+        const char * PST_NAMES[6] = {"PAWN", "KNIGHT", "BISHOP", "ROOK", "QUEEN", "KING"};
+        for (int i = 0; i < 6; i++) {
+            int pc = BPAWN + i;
+            bool pawn_hash = pc == BPAWN || pc == BKING;
+            for (int sq = a1; sq <= h8; sq++) {
+                if (pc == BPAWN && (sq < a2 || sq > h7)) {
+                    continue;
+                }
+                std::ostringstream name;
+                name << "PST_" << PST_NAMES[i] << "[" << sq << "]";
+                add_param(name.str() + ".mg", &PST::table[pc][sq].mg, -128, 127, pawn_hash);
+                add_param(name.str() + ".eg", &PST::table[pc][sq].eg, -128, 127, pawn_hash);
+            }
+        }
+        first_score = params.size();
+        add_score("pawns::ISOLATED[0]", &pawns::ISOLATED[0], true);
+        add_score("pawns::ISOLATED[1]", &pawns::ISOLATED[1], true);
+        add_score("pawns::WEAK[0]", &pawns::WEAK[0], true);
+        add_score("pawns::WEAK[1]", &pawns::WEAK[1], true);
+        add_score("pawns::DOUBLED", &pawns::DOUBLED, true);
+        add_score("pawns::BLOCKED_CENTER_PAWN", &pawns::BLOCKED_CENTER_PAWN, true);
+        add_score("pieces::VBISHOPPAIR", &pieces::VBISHOPPAIR, false);
+        add_score("pieces::DEFENDED", &pieces::DEFENDED, false);
+        add_score("pieces::ROOK_7TH", &pieces::ROOK_7TH, false);
+        add_score("pieces::SEMIOPEN_FILE", &pieces::SEMIOPEN_FILE, false);
+        add_score("pieces::OPEN_FILE", &pieces::OPEN_FILE, false);
+        add_score("pieces::CLOSED_FILE", &pieces::CLOSED_FILE, false);
+        add_score("pieces::SUPPORTED_PASSER", &pieces::SUPPORTED_PASSER, false);
+        add_score("pieces::CONNECTED_ROOKS", &pieces::CONNECTED_ROOKS, false);
+    }
+
+    /**
+     * Sets a parameter and invalidates cached evaluation terms
+     */
+    void set_param(param_t & p, int value) {
+        *p.value = value;
+        sync_pst();
+        if (p.pawn_hash) {
+            pawn_table::clear();
+        }
+    }
+
+    void print_pst(const char * name, int pc, bool eg) {
+        std::cout << "int8_t PST_" << name << (eg ? "_EG" : "_MG") << "[64] = {";
+        for (int sq = a1; sq <= h8; sq++) {
+            std::cout << (sq % 8 ? " " : "\n    ") << std::setw(3)
+                    << (eg ? PST::table[pc][sq].eg : PST::table[pc][sq].mg) << (sq < h8 ? "," : "");
+        }
+        std::cout << "\n};\n" << std::endl;
+    }
+
+    void print_params() {
+        const char * PST_NAMES[6] = {"PAWN", "KNIGHT", "BISHOP", "ROOK", "QUEEN", "KING"};
+        for (int i = 0; i < 6; i++) {
+            print_pst(PST_NAMES[i], BPAWN + i, false);
+            print_pst(PST_NAMES[i], BPAWN + i, true);
+        }
+        for (size_t i = first_score; i < params.size(); i += 2) {
+            std::string name = params[i].name.substr(0, params[i].name.size() - 3);
+            std::cout << name << " = S(" << *params[i].value << ", " << *params[i + 1].value << ");" << std::endl;
+        }
+    }
+
+    /**
+     * Local search: each parameter is moved up or down by one grain as long as
+     * the error decreases
+     */
+    void tune(double k, int rounds) {
+        double best = error(k);
+        std::cout << "Error: " << std::setprecision(8) << best << std::endl;
+        for (int round = 1; round <= rounds; round++) {
+            int improved = 0;
+            for (size_t i = 0; i < params.size(); i++) {
+                param_t & p = params[i];
+                const int value = *p.value;
+                bool found = false;
+                for (int dir = 1; dir >= -1 && !found; dir -= 2) {
+                    int candidate = value + dir * GRAIN_SIZE;
+                    if (candidate < p.min || candidate > p.max) {
+                        continue;
+                    }
+                    set_param(p, candidate);
+                    double err = error(k);
+                    if (err < best) {
+                        best = err;
+                        found = true;
+                        improved++;
+                    }
+                }
+                if (!found) {
+                    set_param(p, value);
+                }
+            }
+            std::cout << "Round " << round << ": error " << best << ", " << improved
+                    << " parameters improved" << std::endl;
+            if (improved == 0) {
+                break;
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace texel;
+    if (argc < 2) {
+        std::cout << "Usage: texel <dataset> [threads] [qsearch] [rounds]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    worker_count = argc > 2 ? atoi(argv[2]) : 0;
+    if (worker_count <= 0) {
+        worker_count = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    worker_count = range(1, MAX_THREADS, worker_count);
+    const bool qsearch = argc > 3 && atoi(argv[3]) != 0;
+    const int rounds = argc > 4 ? atoi(argv[4]) : 100;
+
+    magic::init();
+    pawn_table::set_size(1);
+    const char * START = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    search_t * loader = new search_t(START);
+    std::cout << "Loading " << argv[1] << std::flush;
+    if (!load(argv[1], loader) || positions.empty()) {
+        std::cout << "\nError: no positions loaded" << std::endl;
+        return EXIT_FAILURE;
+    }
+    delete loader;
+    std::cout << "\nPositions: " << positions.size() << " (" << (positions.size() * sizeof (position_t) >> 20)
+            << " MB), threads: " << worker_count << (qsearch ? ", qsearch" : "") << std::endl;
+
+    const size_t count = positions.size();
+    for (int i = 0; i < worker_count; i++) {
+        worker_t * w = &workers[i];
+        w->s = new search_t(START, &w->settings);
+        w->s->set_thread(i);
+        w->s->ecache = NULL; //the parameters change between evaluations
+        w->first = &positions[0] + count * i / worker_count;
+        w->count = count * (i + 1) / worker_count - count * i / worker_count;
+        w->qsearch = qsearch;
+    }
+    init_params();
+
+    double k = find_k();
+    std::cout << "K: " << k << std::endl;
+    tune(k, rounds);
+    print_params();
+
+    for (int i = 0; i < worker_count; i++) {
+        delete workers[i].s;
+    }
+    return EXIT_SUCCESS;
+}
@@ -24,6 +24,9 @@
  */
 
 #include "bbmoves.h"
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
 
 namespace magic {
     
@@ -36,6 +39,27 @@ namespace magic {
 
     U64 _MAGIC_MOVES_ROOK_DB[64][1 << 12];
 
+    U64 _BETWEEN[64][64];
+
+    U64 _LINE[64][64];
+
+    /*
+     * PEXT tables, all squares packed in one array (bishops: 5248 entries, 
+     * rooks: 102400 entries)
+     */
+
+    bool _use_pext = false;
+
+    U64 _PEXT_BISHOP_DB[5248];
+
+    U64 _PEXT_ROOK_DB[102400];
+
+    U64 * _PEXT_BISHOP[64];
+
+    U64 * _PEXT_ROOK[64];
+
+    bool _slow_pext();
+
     U64 _init_occ(const int* squares, const int num_squares, const U64 linocc) {
         int i;
         U64 ret = 0;
@@ -124,6 +148,7 @@ namespace magic {
      */
     void init(void) {
         int i;
+        _use_pext = false;
 
         const int _BITPOS64_DB[64] = {
             63, 0, 58, 1, 59, 47, 53, 2,
@@ -165,5 +190,93 @@ namespace magic {
                 _ROOK_MAGIC_NOMASK2(i, tempocc) = _init_rook_moves(i, tempocc);
             }
         }
+
+        //pext tables: enumerating the subsets of a mask in carry-rippler order
+        //counts up the extracted index, so the pext instruction is not needed here
+        U64 * bishop_db = _PEXT_BISHOP_DB;
+        U64 * rook_db = _PEXT_ROOK_DB;
+        for (i = 0; i < 64; i++) {
+            _PEXT_BISHOP[i] = bishop_db;
+            U64 occ = 0;
+            do {
+                *bishop_db++ = _init_bishop_moves(i, occ);
+                occ = (occ - _MAGIC_MOVES_BISHOP_MASK[i]) & _MAGIC_MOVES_BISHOP_MASK[i];
+            } while (occ);
+            _PEXT_ROOK[i] = rook_db;
+            occ = 0;
+            do {
+                *rook_db++ = _init_rook_moves(i, occ);
+                occ = (occ - _MAGIC_MOVES_ROOK_MASK[i]) & _MAGIC_MOVES_ROOK_MASK[i];
+            } while (occ);
+        }
+        assert(bishop_db == _PEXT_BISHOP_DB + 5248);
+        assert(rook_db == _PEXT_ROOK_DB + 102400);
+
+        //lines and squares in between, used for pins and check evasions
+        for (int sq1 = 0; sq1 < 64; sq1++) {
+            for (int sq2 = 0; sq2 < 64; sq2++) {
+                _BETWEEN[sq1][sq2] = 0;
+                _LINE[sq1][sq2] = 0;
+                if (sq1 == sq2) {
+                    continue;
+                } else if (BISHOP_MOVES[sq1] & BIT(sq2)) {
+                    _BETWEEN[sq1][sq2] = bishop_moves(sq1, BIT(sq2)) & bishop_moves(sq2, BIT(sq1));
+                    _LINE[sq1][sq2] = (bishop_moves(sq1, 0) & bishop_moves(sq2, 0)) | BIT(sq1) | BIT(sq2);
+                } else if (ROOK_MOVES[sq1] & BIT(sq2)) {
+                    _BETWEEN[sq1][sq2] = rook_moves(sq1, BIT(sq2)) & rook_moves(sq2, BIT(sq1));
+                    _LINE[sq1][sq2] = (rook_moves(sq1, 0) & rook_moves(sq2, 0)) | BIT(sq1) | BIT(sq2);
+                }
+            }
+        }
+
+        //AMD cpus before Zen 3 implement pext in microcode, slower than magics
+        _use_pext = pext_supported() && !_slow_pext();
+    }
+
+    /**
+     * Test if the cpu supports the BMI2 instruction set (pext)
+     * @return true if supported
+     */
+    bool pext_supported() {
+#if defined(__x86_64__) && defined(__GNUC__)
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid_max(0, 0) < 7) {
+            return false;
+        }
+        __cpuid_count(7, 0, eax, ebx, ecx, edx);
+        return (ebx & bit_BMI2) != 0;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Test for a cpu with a microcoded (slow) pext instruction: AMD family 
+     * 0x17 (Zen 1 and Zen 2) and older
+     * @return true if pext is slow
+     */
+    bool _slow_pext() {
+#if defined(__x86_64__) && defined(__GNUC__)
+        unsigned int eax, ebx, ecx, edx;
+        __cpuid(0, eax, ebx, ecx, edx);
+        if (ebx != signature_AMD_ebx) {
+            return false;
+        }
+        __cpuid(1, eax, ebx, ecx, edx);
+        int family = ((eax >> 8) & 0xF) + ((eax >> 20) & 0xFF);
+        return family < 0x19;
+#else
+        return true;
+#endif
+    }
+
+    /**
+     * Selects the sliding piece attack backend
+     * @param enable use pext (if supported) or magic multiplication
+     * @return true if pext is used
+     */
+    bool select_pext(bool enable) {
+        _use_pext = enable && pext_supported();
+        return _use_pext;
     }
 }
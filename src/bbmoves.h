@@ -21,6 +21,10 @@
  * - Magic bitboards with credits and thanks to Pradyumna Kannan. The original 
  *   code for magic bitboards is available at his website. 
  * 
+ * - PEXT bitboards: on CPUs with fast BMI2, the attack tables are indexed with
+ *   the pext instruction instead of a magic multiplication. The backend is
+ *   selected at startup, the interface is the same.
+ * 
  * Note the function InitMagicMoves() needs to be called before using the engine.
  */
 
@@ -312,6 +316,26 @@ namespace magic {
     extern U64 _MAGIC_MOVES_BISHOP_DB[64][1 << 9];
     extern U64 _MAGIC_MOVES_ROOK_DB[64][1 << 12];
 
+    extern bool _use_pext;
+    extern U64 * _PEXT_BISHOP[64];
+    extern U64 * _PEXT_ROOK[64];
+
+    /**
+     * Parallel bits extract (BMI2), only used if the cpu supports it
+     * @param src source bits
+     * @param mask bits to extract
+     * @return the extracted bits, packed in the low bits
+     */
+    inline U64 _pext(const U64 src, const U64 mask) {
+#if defined(__x86_64__) && defined(__GNUC__)
+        U64 result;
+        __asm__("pextq %2, %1, %0" : "=r" (result) : "r" (src), "r" (mask));
+        return result;
+#else
+        return 0;
+#endif
+    }
+
     /**
      * Return Bishop Moves given a square and board occupancy
      * @param sq the square
@@ -319,6 +343,9 @@ namespace magic {
      * @return bitboard populated with bishop moves
      */
     inline U64 bishop_moves(const unsigned int sq, const U64 occ) {
+        if (_use_pext) {
+            return _PEXT_BISHOP[sq][_pext(occ, _MAGIC_MOVES_BISHOP_MASK[sq])];
+        }
         return _MAGIC_MOVES_BISHOP_DB[sq][(((occ) & _MAGIC_MOVES_BISHOP_MASK[sq]) * _MAGIC_MOVES_BISHOP_MAGICS[sq]) >> _MINIMAL_B_BITS_SHIFT(sq)];
     }
 
@@ -329,6 +356,9 @@ namespace magic {
      * @return bitboard populated with rook moves
      */
     inline U64 rook_moves(const unsigned int sq, const U64 occ) {
+        if (_use_pext) {
+            return _PEXT_ROOK[sq][_pext(occ, _MAGIC_MOVES_ROOK_MASK[sq])];
+        }
         return _MAGIC_MOVES_ROOK_DB[sq][(((occ) & _MAGIC_MOVES_ROOK_MASK[sq]) * _MAGIC_MOVES_ROOK_MAGICS[sq]) >> _MINIMAL_R_BITS_SHIFT(sq)];
     }
 
@@ -342,7 +372,32 @@ namespace magic {
         return bishop_moves(sq, occ) | rook_moves(sq, occ);
     }
 
+    extern U64 _BETWEEN[64][64];
+    extern U64 _LINE[64][64];
+
+    /**
+     * Return the squares between two squares on the same rank, file or diagonal
+     * @param sq1 first square
+     * @param sq2 second square
+     * @return bitboard populated with the squares in between, empty if not aligned
+     */
+    inline U64 between(const int sq1, const int sq2) {
+        return _BETWEEN[sq1][sq2];
+    }
+
+    /**
+     * Return the full rank, file or diagonal through two squares
+     * @param sq1 first square
+     * @param sq2 second square
+     * @return bitboard populated with the line, empty if not aligned
+     */
+    inline U64 line(const int sq1, const int sq2) {
+        return _LINE[sq1][sq2];
+    }
+
     void init(void); //initialize magic moves (required)
+    bool pext_supported(); //cpu supports bmi2
+    bool select_pext(bool enable); //select the attack backend, returns true if pext is used
 
 }
 
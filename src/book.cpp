@@ -24,6 +24,10 @@
  * Public License, and can be downloaded from http://wbec-ridderkerk.nl
  */
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "book.h"
 
 using namespace std;
@@ -248,7 +252,7 @@ namespace {
 int book_t::find(board_t * brd, move::list_t * list) {
     int result = 0;
     list->clear();
-    if (!is_open() || this->book_size == 0) {
+    if (!is_open()) {
         return 0;
     }
     book_entry_t entry;
@@ -261,10 +265,10 @@ int book_t::find(board_t * brd, move::list_t * list) {
         if (entry.weight == 0) {
             continue;
         }
-        move_t * move = list->last++;
-        read_polyglot_move(brd, move, entry.move);
-        move->score = entry.weight;
-        result += move->score;
+        move_t move;
+        read_polyglot_move(brd, &move, entry.move);
+        list->push(move.to_int(), entry.weight);
+        result += entry.weight;
     }
     return result;
 }
@@ -323,12 +327,20 @@ void book_t::read_polyglot_move(board_t * brd, move_t * move, int polyglot_move)
  * Closes a book file
  */
 void book_t::close() {
-    if (is_open())
-        ifstream::close();
+    if (data) {
+        munmap((void *) data, mapped_size);
+    }
+    data = NULL;
+    mapped_size = 0;
+    book_size = 0;
+}
+
+bool book_t::is_open() {
+    return data != NULL;
 }
 
 /**
- * Opens a book file
+ * Opens a book file by mapping it read-only into memory
  * @param fname the filename 
  */
 void book_t::open(const string &fname) {
@@ -339,21 +351,24 @@ void book_t::open(const string &fname) {
     close();
 
     file_name = fname;
-    ifstream::open(file_name.c_str(), ifstream::in | ifstream::binary);
+    int fd = ::open(file_name.c_str(), O_RDONLY);
 
     // Silently return when asked to open a non-exsistent file
-    if (!is_open()) {
+    if (fd < 0) {
         return;
     }
 
     // Get the book size in number of entries
-    seekg(0, ios::end);
-    book_size = long(tellg()) / ENTRY_SIZE;
-    seekg(0, ios::beg);
-
-    if (!good()) {
-        exit(EXIT_FAILURE);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= ENTRY_SIZE) {
+        void * mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mem != MAP_FAILED) {
+            data = (const unsigned char *) mem;
+            mapped_size = st.st_size;
+            book_size = st.st_size / ENTRY_SIZE;
+        }
     }
+    ::close(fd);
 }
 
 /**
@@ -372,51 +387,54 @@ const string book_t::get_file_name() {
  */
 int book_t::find_key(U64 key) {
     assert(book_size > 0);
-    book_entry_t entry;
     int left = 0;
     int right = book_size - 1;
     while (left < right) {
         int mid = (left + right) / 2;
         assert(mid >= left && mid < right);
-        read_entry(entry, mid);
-        if (key <= entry.key) {
+        if (key <= read_key(mid)) {
             right = mid;
         } else {
             left = mid + 1;
         }
     }
     assert(left == right);
-    read_entry(entry, left);
-    return entry.key == key ? left : book_size;
+    return read_key(left) == key ? left : book_size;
+}
+
+/**
+ * Reads the key of the entry at the given index directly from the mapped file
+ */
+U64 book_t::read_key(int idx) {
+    assert(idx >= 0 && idx < book_size);
+    return read_integer(data + idx * ENTRY_SIZE, 8);
 }
 
 /**
  * Book::read_entry() takes a BookEntry reference and an integer index as
  * input, and looks up the opening book entry at the given index in the book
- * file. The book entry is copied to the first input parameter.
+ * file. The book entry is decoded into the first input parameter.
  */
 void book_t::read_entry(book_entry_t& entry, int idx) {
     assert(idx >= 0 && idx < book_size);
     assert(is_open());
-    seekg(idx * ENTRY_SIZE, ios_base::beg);
-    *this >> entry;
-    if (!good()) {
-        exit(EXIT_FAILURE);
-    }
+    const unsigned char * p = data + idx * ENTRY_SIZE;
+    entry.key = read_integer(p, 8);
+    entry.move = read_integer(p + 8, 2);
+    entry.weight = read_integer(p + 10, 2);
+    entry.learn1 = read_integer(p + 12, 2);
+    entry.learn2 = read_integer(p + 14, 2);
 }
 
 
-/// Book::read_integer() reads size chars from the file stream
-/// and converts them in an integer number.
+/// Book::read_integer() converts size big-endian bytes to an integer number.
 
-U64 book_t::read_integer(int size) {
-    char buf[8];
+U64 book_t::read_integer(const unsigned char * p, int size) {
     U64 n = 0;
-    read(buf, size);
 
     // Numbers are stored on disk as a binary byte stream
     for (int i = 0; i < size; i++) {
-        n = (n << 8) + (unsigned char) buf[i];
+        n = (n << 8) + p[i];
     }
     return n;
 }
@@ -456,26 +474,32 @@ U64 book_t::polyglot_key(board_t* pos) {
 }
 
 namespace book {
-    book_t _book;
-
-    void open(const std::string& file_name) {
-        _book.open(file_name);
-    }
-
-    void close() {
-        _book.close();
-    }
-
-    int find(board_t * pos, move::list_t * list) {
-        return _book.find(pos, list);
+    const int MAX_BOOKS = 8;
+    book_t * _books[MAX_BOOKS] = {NULL};
+    std::string _names[MAX_BOOKS];
+    pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    /**
+     * Gets a book by file name. A book is opened the first time it is 
+     * requested and stays open, so it can be shared by all search threads.
+     * @param file_name book file name
+     * @return the book, which is empty if the file could not be opened, or 
+     * NULL if too many books are in use
+     */
+    book_t * get(const std::string& file_name) {
+        book_t * result = NULL;
+        pthread_mutex_lock(&_mutex);
+        for (int i = 0; i < MAX_BOOKS && result == NULL; i++) {
+            if (_books[i] == NULL) {
+                _books[i] = new book_t();
+                _books[i]->open(file_name);
+                _names[i] = file_name;
+                result = _books[i];
+            } else if (_names[i] == file_name) {
+                result = _books[i];
+            }
+        }
+        pthread_mutex_unlock(&_mutex);
+        return result;
     }
 };
-
-
-
-
-
-
-
-
-
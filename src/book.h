@@ -39,12 +39,18 @@ struct book_entry_t {
     unsigned short learn2;
 };
 
-class book_t : private std::ifstream {
+/**
+ * Polyglot book. The book file is memory mapped read-only and searched in 
+ * place, so one book_t can be shared by all threads.
+ */
+class book_t {
     
 public:
     
     book_t() {
         book_size = 0;
+        data = NULL;
+        mapped_size = 0;
         file_name = "";
     }
     
@@ -53,6 +59,7 @@ public:
     }
     void open(const std::string& file_name);
     void close();
+    bool is_open();
     const std::string get_file_name();
     static U64 polyglot_key(board_t* pos);
     int find(board_t * pos, move::list_t * list);
@@ -61,30 +68,16 @@ public:
 private:
     std::string file_name;
     int book_size;  
-    U64 read_integer(int size);
+    const unsigned char * data;
+    size_t mapped_size;
+    U64 read_integer(const unsigned char * p, int size);
     void read_entry(book_entry_t &e, int n);
+    U64 read_key(int n);
     int find_key(U64 key);
-
-    book_t& operator>>(U64& n) {
-        n = read_integer(8);
-        return *this;
-    }
-
-    book_t& operator>>(uint16_t &n) {
-        n = (uint16_t) read_integer(2);
-        return *this;
-    }
-
-    void operator>>(book_entry_t &e) {
-        *this >> e.key >> e.move >> e.weight >> e.learn1 >> e.learn2;
-    }
-    
 };
 
 namespace book {
-    void open(const std::string& file_name);
-    void close();
-    int find(board_t * pos, move::list_t * list);
+    book_t * get(const std::string& file_name);
 };
 
 #endif	/* BOOK_H */
@@ -47,17 +47,33 @@ namespace engine {
         _engine.analyse();
     }
 
+    U64 bench(int depth, int threads, int hash) {
+        _stopped = false;
+        return _engine.bench(depth, threads, hash);
+    }
+
+    U64 perft(int depth, int threads, int hash) {
+        _stopped = false;
+        return _engine.perft(depth, threads, hash);
+    }
+
     void learn() {
         _stopped = false;
         _engine.learn();
     }
 
+    void spsa(std::string file_name) {
+        _stopped = false;
+        _engine.spsa(file_name);
+    }
+
     void book_calc() {
         _stopped = false;
         _engine.book_calc();
     }
 
     void new_game(std::string fen) {
+        stop(); //the table is cleared on the workers of the search threads
         _engine.new_game(fen);
     }
 
@@ -78,6 +94,10 @@ namespace engine {
         return _ponder;
     }
 
+    U64 helper_nodes() {
+        return _engine.helper_nodes();
+    }
+
     engine_t * instance() {
         return &_engine;
     }
@@ -98,7 +118,25 @@ engine_t::engine_t() : threads_t() {
     _root_fen = "";
     _result_move.clear();
     _result_score = 0;
+    _helper_count = 0;
+    _main = NULL;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        _helpers[i] = NULL;
+    }
     _game.clear();
+    trans_table::set_pool(&_pool);
+}
+
+/**
+ * Destruct engine thread, stopping the search and freeing the search objects
+ */
+engine_t::~engine_t() {
+    stop();
+    trans_table::set_pool(NULL);
+    delete _main;
+    for (int i = 0; i < MAX_THREADS; i++) {
+        delete _helpers[i];
+    }
 }
 
 /**
@@ -113,14 +151,150 @@ void engine_t::new_game(std::string fen) {
 }
 
 /**
- * Copies search results
- * @param s search object
+ * Copies search results. If helper threads were searching, the best move
+ * is chosen by voting.
+ * @param s (main) search object
+ * @return the search object providing the results
+ */
+search_t * engine_t::copy_results(search_t * s) {
+    search_t * best = s->result_depth > 0 ? _vote(s) : s;
+    set_target_found(best->stack->best_move.equals(&_game.target_move));
+    set_move(&best->stack->best_move);
+    set_score(best->result_score);
+    set_total_nodes(s->nodes + helper_nodes());
+    return best;
+}
+
+/**
+ * Lazy SMP result voting. Each thread votes for its best move, weighted by 
+ * the depth of its last completed iteration and its score.
+ * @param s main search object
+ * @return the (deepest) search object with the most voted for move
+ */
+search_t * engine_t::_vote(search_t * s) {
+    search_t * threads[MAX_THREADS];
+    int count = 0;
+    threads[count++] = s;
+    for (int i = 0; i < _helper_count; i++) {
+        if (_helpers[i]->result_depth > 0 && _helpers[i]->stack->best_move.piece) {
+            threads[count++] = _helpers[i];
+        }
+    }
+    int min_score = score::INF;
+    for (int i = 0; i < count; i++) {
+        min_score = MIN(min_score, threads[i]->result_score);
+    }
+    search_t * best = s;
+    int best_votes = 0;
+    for (int i = 0; i < count; i++) {
+        move_t * move = &threads[i]->stack->best_move;
+        int votes = 0;
+        for (int j = 0; j < count; j++) {
+            if (threads[j]->stack->best_move.equals(move)) {
+                votes += (threads[j]->result_score - min_score + 14) * threads[j]->result_depth;
+            }
+        }
+        if (votes > best_votes || (votes == best_votes && threads[i]->result_depth > best->result_depth)) {
+            best_votes = votes;
+            best = threads[i];
+        }
+    }
+    return best;
+}
+
+/**
+ * Sum of the nodes searched by the helper threads
+ * @return node count
+ */
+U64 engine_t::helper_nodes() {
+    U64 result = 0;
+    for (int i = 0; i < _helper_count; i++) {
+        result += _helpers[i]->nodes;
+    }
+    return result;
+}
+
+/**
+ * Creates a search object for the current position and variant
+ * @return search object
+ */
+search_t * engine_t::_create_search() {
+    if (options::get_value("Wild") == 17) {
+        return new w17_search_t(_root_fen.c_str(), settings());
+    }
+    return new search_t(_root_fen.c_str(), settings());
+}
+
+/**
+ * Prepares a search object from a previous search for the current position, 
+ * so it does not have to be allocated again. A new object is created if there 
+ * is none yet or if the variant has changed.
+ * @param s search object from a previous search or NULL
+ * @param thread_id search thread index
+ * @return search object
  */
-void engine_t::copy_results(search_t * s) {
-    set_target_found(s->stack->best_move.equals(&_game.target_move));
-    set_move(&s->stack->best_move);
-    set_score(s->result_score);
-    set_total_nodes(s->nodes);
+search_t * engine_t::_reuse_search(search_t * s, int thread_id) {
+    const bool w17 = options::get_value("Wild") == 17;
+    if (s && (s->wild == 17) != w17) {
+        delete s;
+        s = NULL;
+    }
+    if (s) {
+        s->reset(_root_fen.c_str(), settings());
+    } else {
+        s = _create_search();
+    }
+    s->set_thread(thread_id);
+    return s;
+}
+
+/**
+ * Prepares Threads - 1 helper search objects (Lazy SMP). This is done before 
+ * the main search is initialized, so any first time allocation does not count 
+ * as thinking time.
+ */
+void engine_t::_prepare_helpers() {
+    const int count = range(1, MAX_THREADS, options::get_value("Threads"));
+    _helper_count = 0;
+    for (int i = 1; i < count; i++) {
+        _helpers[i - 1] = _reuse_search(_helpers[i - 1], i);
+    }
+    _helper_count = count - 1;
+}
+
+/**
+ * Starts the helper searches on the worker pool. The helpers search the same 
+ * root position and share the transposition table with the main search.
+ */
+void engine_t::_start_helpers() {
+    for (int i = 0; i < _helper_count; i++) {
+        _pool.start(i + 1, _help, _helpers[i]);
+    }
+}
+
+/**
+ * Stops all helper searches and waits until their workers are idle
+ */
+void engine_t::_stop_helpers() {
+    for (int i = 0; i < _helper_count; i++) {
+        _helpers[i]->stop_all = true;
+    }
+    for (int i = 0; i < _helper_count; i++) {
+        _pool.wait_for(i + 1);
+    }
+}
+
+/**
+ * Thread function for a Lazy SMP helper thread
+ * @param search_p pointer to the helper search object
+ * @return NULL
+ */
+void * engine_t::_help(void * search_p) {
+    search_t * s = (search_t*) search_p;
+    if (s->init_root_moves() > 0) {
+        s->iterative_deepening();
+    }
+    return NULL;
 }
 
 /**
@@ -132,23 +306,228 @@ void * engine_t::_think(void * engine_p) {
 
     //initialize
     engine_t * engine = (engine_t*) engine_p;
-    search_t * s;
-    if (options::get_value("Wild") == 17) {
-        s = new w17_search_t(engine->_root_fen.c_str(), engine->settings());
-    } else {
-        s = new search_t(engine->_root_fen.c_str(), engine->settings());
-    }
+    engine->_prepare_helpers();
+    search_t * s = engine->_main = engine->_reuse_search(engine->_main, 0);
+    engine->_start_helpers();
 
     //think
     s->go();
+    engine->_stop_helpers();
 
-    //copy search results and clean up
-    engine->copy_results(s);
-    delete s;
-    pthread_exit(NULL);
+    //copy search results and send the best move
+    search_t * best = engine->copy_results(s);
+    if (best != s) {
+        uci::send_pv(best->result_score, best->result_depth, best->sel_depth, engine->get_total_nodes(),
+                s->game->tm.elapsed(), s->ttable->hashfull(s->brd.root_ply), best->pv_to_string().c_str(), score::EXACT);
+    }
+    uci::send_bestmove(best->stack->best_move, best->ponder_move);
     return NULL;
 }
 
+/**
+ * Positions searched by the bench command. The halfmove clocks are zero, so 
+ * the search never looks into the repetition table of the current game.
+ */
+const char * BENCH_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 11",
+    "4rrk1/pp1n3p/3q2pQ/2p1pb2/2PP4/2P3N1/P2B2PP/4RRK1 b - - 0 19",
+    "rq3rk1/ppp2ppp/1bnpb3/3N2B1/3NP3/7P/PPPQ1PP1/2KR3R w - - 0 14",
+    "r1bq1r1k/1pp1n1pp/1p1p4/4p2Q/4Pp2/1BNP4/PPP2PPP/3R1RK1 w - - 0 14",
+    "r3r1k1/2p2ppp/p1p1bn2/8/1q2P3/2NPQN2/PPP3PP/R4RK1 b - - 0 15",
+    "r1bbk1nr/pp3p1p/2n5/1N4p1/2Np1B2/8/PPP2PPP/2KR1B1R w kq - 0 13",
+    "r1bq1rk1/ppp1nppp/4n3/3p3Q/3P4/1BP1B3/PP1N2PP/R4RK1 w - - 0 16",
+    "4r1k1/r1q2ppp/ppp2n2/4P3/5Rb1/1N1BQ3/PPP3PP/R5K1 w - - 0 17",
+    "2rqkb1r/ppp2p2/2npb1p1/1N1Nn2p/2P1PP2/8/PP2B1PP/R1BQK2R b KQ - 0 11",
+    "r1bq1r1k/b1p1npp1/p2p3p/1p6/3PP3/1B2NN2/PP3PPP/R2Q1RK1 w - - 0 16",
+    "3r1rk1/p5pp/bpp1pp2/8/q1PP1P2/b3P3/P2NQRPP/1R2B1K1 b - - 0 22",
+    "r1q2rk1/2p1bppp/2Pp4/p6b/Q1PNp3/4B3/PP1R1PPP/2K4R w - - 0 18",
+    "4k2r/1pb2ppp/1p2p3/1R1p4/3P4/2r1PN2/P4PPP/1R4K1 b - - 0 22",
+    "3q2k1/pb3p1p/4pbp1/2r5/PpN2N2/1P2P2P/5PP1/Q2R2K1 b - - 0 26",
+    "6k1/6p1/6Pp/ppp5/3pn2P/1P3K2/1PP2P2/3N4 b - - 0 1",
+    "3b4/5kp1/1p1p1p1p/pP1PpP1P/P1P1P3/3KN3/8/8 w - - 0 1",
+    "2K5/p7/7P/5pR1/8/5k2/r7/8 w - - 0 1",
+    "8/6pk/1p6/8/PP3p1p/5P2/4KP1q/3Q4 w - - 0 1",
+    "7k/3p2pp/4q3/8/4Q3/5Kp1/P6b/8 w - - 0 1",
+    "8/2p5/8/2kPKp1p/2p4P/2P5/3P4/8 w - - 0 1",
+    "8/1p3pp1/7p/5P1P/2k3P1/8/2K2P2/8 w - - 0 1",
+    "8/pp2r1k1/2p1p3/3pP2p/1P1P1P1P/P5KR/8/8 w - - 0 1",
+    "8/3p4/p1bk3p/Pp6/1Kp1PpPp/2P2P1P/2P5/5B2 b - - 0 1",
+    "5k2/7R/4P2p/5K2/p1r2P1p/8/8/8 b - - 0 1",
+    "6k1/6p1/P6p/r1N5/5p2/7P/1b3PP1/4R1K1 w - - 0 1",
+    "1r3k2/4q3/2Pp3b/3Bp3/2Q2p2/1p1P2P1/1P2KP2/3N4 w - - 0 1",
+    "6k1/4pp1p/3p2p1/P1pPb3/R7/1r2P1PP/3B1P2/6K1 w - - 0 1",
+    "8/3p3B/5p2/5P2/p7/PP5b/k7/6K1 w - - 0 1",
+    "r3k2r/3nnpbp/q2pp1p1/p7/Pp1PPPP1/4BNN1/1P5P/R2Q1RK1 w kq - 0 16",
+    "4k3/3q1r2/1N2r1b1/3ppN2/2nPP3/1B1R2n1/2R1Q3/3K4 w - - 0 1",
+    "8/8/8/8/5kp1/P7/8/1K1N4 w - - 0 1",
+    "8/8/8/5N2/8/p7/8/2NK3k w - - 0 1",
+    "8/3k4/8/8/8/4B3/4KB2/2B5 w - - 0 1",
+    "8/8/1P6/5pr1/8/4R3/7k/2K5 w - - 0 1",
+    "8/2p4P/8/kr6/6R1/8/8/1K6 w - - 0 1",
+    "8/8/3P3k/8/1p6/8/1P6/1K3n2 b - - 0 1",
+    "8/R7/2q5/8/6k1/8/1P5p/K6R w - - 0 124",
+    "6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1",
+    "r2r1n2/pp2bk2/2p1p2p/3q4/3PN1QP/2P3R1/P4PP1/5RK1 w - - 0 1"
+};
+
+/**
+ * Searches the bench positions to a fixed depth and reports nodes, time and 
+ * speed. With one thread the total node count is deterministic and serves 
+ * as a signature of the search.
+ * @param depth search depth
+ * @param threads amount of search threads
+ * @param hash transposition table size in MB
+ * @return total nodes searched
+ */
+U64 engine_t::bench(int depth, int threads, int hash) {
+    options::option_t * threads_opt = options::get_option("Threads");
+    options::option_t * book_opt = options::get_option("OwnBook");
+    const int saved_threads = threads_opt->value;
+    const int saved_book = book_opt->value;
+    const int saved_hash = options::get_value("Hash");
+    threads_opt->value = range(1, MAX_THREADS, threads);
+    book_opt->value = 0;
+    trans_table::set_size(hash);
+    const int count = sizeof (BENCH_POSITIONS) / sizeof (BENCH_POSITIONS[0]);
+    U64 total_nodes = 0, evals = 0, tt_evals = 0, cached_evals = 0;
+    const int64_t begin = time_man::now();
+    for (int i = 0; i < count; i++) {
+        _game.clear();
+        _game.max_depth = depth;
+        new_game(BENCH_POSITIONS[i]);
+        uci::silent(true);
+        think();
+        wait();
+        uci::silent(false);
+        total_nodes += get_total_nodes();
+        evals += _main->evals;
+        tt_evals += _main->tt_evals;
+        cached_evals += _main->cached_evals;
+        for (int j = 0; j < _helper_count; j++) {
+            evals += _helpers[j]->evals;
+            tt_evals += _helpers[j]->tt_evals;
+            cached_evals += _helpers[j]->cached_evals;
+        }
+        uci::send_string("bench position " + uci::itoa(i + 1) + " move " + get_move().to_string()
+                + " nodes " + uci::itoa(get_total_nodes()));
+    }
+    const int64_t elapsed = MAX(1, (time_man::now() - begin) / 1000);
+    threads_opt->value = saved_threads;
+    book_opt->value = saved_book;
+    trans_table::set_size(saved_hash);
+    uci::send_string("bench nodes " + uci::itoa(total_nodes) + " time " + uci::itoa(elapsed)
+            + " nps " + uci::itoa(total_nodes * 1000 / elapsed));
+    const U64 total_evals = MAX(1, evals + tt_evals + cached_evals);
+    uci::send_string("bench evaluations " + uci::itoa(evals + tt_evals + cached_evals) + ", taken from hash "
+            + uci::itoa(tt_evals * 100 / total_evals) + "%, from eval cache " + uci::itoa(cached_evals * 100 / total_evals) + "%");
+    uci::send_string("bench signature " + uci::itoa(total_nodes));
+    return total_nodes;
+}
+
+/**
+ * Counts the leaf nodes of the legal move tree of the actual position. The
+ * root moves are divided over the threads, subtree counts are stored in a 
+ * perft table and the leaf moves are counted without making them.
+ * @param depth perft depth
+ * @param threads amount of threads
+ * @param hash perft table size in MB, 0 for no table
+ * @return leaf node count
+ */
+U64 engine_t::perft(int depth, int threads, int hash) {
+    perft_job_t * job = new perft_job_t;
+    board_t * brd = new board_t();
+    move::list_t * list = new move::list_t();
+    brd->init(_root_fen.c_str());
+    move::gen_evasions(brd, list);
+    job->fen = _root_fen;
+    job->move_count = 0;
+    for (int i = list->first; i != list->last; i++) {
+        list->get(brd, i, &job->moves[job->move_count++]);
+    }
+    memset(job->counts, 0, sizeof (job->counts));
+    job->next_move = 0;
+    job->depth = MAX(1, depth);
+    job->table = hash > 0 ? new perft_table::table_t(hash) : NULL;
+    const int64_t begin = time_man::now();
+    threads = range(1, MAX_THREADS, threads);
+    for (int i = 0; i < threads; i++) {
+        if (!_pool.start(i, _perft_worker, job)) {
+            _perft_worker(job); //no worker available: count the remaining moves here
+            break;
+        }
+    }
+    _pool.wait_all();
+    const int64_t elapsed = MAX(1, (time_man::now() - begin) / 1000);
+    U64 total_nodes = 0;
+    for (int i = 0; i < job->move_count; i++) {
+        total_nodes += job->counts[i];
+        uci::send_string("perft " + job->moves[i].to_string() + " " + uci::itoa(job->counts[i]));
+    }
+    uci::send_string("perft nodes " + uci::itoa(total_nodes) + " time " + uci::itoa(elapsed)
+            + " nps " + uci::itoa(total_nodes * 1000 / elapsed));
+    delete job->table;
+    delete job;
+    delete list;
+    delete brd;
+    return total_nodes;
+}
+
+/**
+ * Perft worker, counting the subtrees of root moves until all are done
+ * @param jobObjPtr perft job
+ */
+void * engine_t::_perft_worker(void * jobObjPtr) {
+    perft_job_t * job = (perft_job_t *) jobObjPtr;
+    board_t * brd = new board_t();
+    move::list_t * lists = new move::list_t[MAX_PLY];
+    brd->init(job->fen.c_str());
+    int i;
+    while ((i = __atomic_fetch_add(&job->next_move, 1, __ATOMIC_RELAXED)) < job->move_count) {
+        move_t * move = &job->moves[i];
+        brd->forward(move);
+        job->counts[i] = job->depth > 1 ? _perft(brd, lists, job->depth - 1, job->table) : 1;
+        brd->backward(move);
+    }
+    delete [] lists;
+    delete brd;
+    return NULL;
+}
+
+/**
+ * Recursive perft. At depth 1 the legal moves are counted (bulk counting).
+ * @param brd board
+ * @param lists move list per remaining depth
+ * @param depth remaining depth, at least 1
+ * @param table perft table or NULL
+ * @return leaf node count
+ */
+U64 engine_t::_perft(board_t * brd, move::list_t * lists, int depth, perft_table::table_t * table) {
+    U64 result = 0;
+    const U64 key = brd->stack->tt_key;
+    if (depth > 1 && table && table->retrieve(key, depth, result)) {
+        return result;
+    }
+    move::list_t * list = &lists[depth];
+    list->clear();
+    move::gen_evasions(brd, list);
+    if (depth == 1) {
+        return list->last - list->first;
+    }
+    move_t move;
+    for (int i = list->first; i != list->last; i++) {
+        list->get(brd, i, &move);
+        brd->forward(&move);
+        result += _perft(brd, lists, depth - 1, table);
+        brd->backward(&move);
+    }
+    if (table) {
+        table->store(key, depth, result);
+    }
+    return result;
+}
+
 /**
  * Analyse a chess position by: 
  * - evaluation function
@@ -210,6 +589,7 @@ void print_row(std::string cap, score_t & w, score_t & b, int phase) {
 void engine_t::analyse() {
 
     search_t * s = new search_t(_root_fen.c_str());
+    s->ecache = NULL; //all evaluation components are printed
     evaluate(s);
     int phase = s->stack->mt->phase;
     bool wtm = s->brd.us();
@@ -254,12 +634,10 @@ void * engine_t::_book_calc(void * engine_p) {
 
     //initialize
     engine_t * engine = (engine_t*) engine_p;
-    search_t * s;
-    if (options::get_value("Wild") == 17) {
-        s = new w17_search_t(engine->_root_fen.c_str(), engine->settings());
+    search_t * s = engine->_create_search();
+    if (s->wild == 17) {
         engine->settings()->max_depth = 6 + 2 * popcnt(s->brd.all(s->brd.us()));
     } else {
-        s = new search_t(engine->_root_fen.c_str(), engine->settings());
         engine->settings()->max_depth = 20;
     }
 
@@ -403,16 +781,12 @@ void * engine_t::_learn(void * engineObjPtr) {
     double MAX_WINDOW = 2.0; //maximum adjustment step for lower/upper bound
     double MIN_WINDOW_ADJ = 0.1; //minimum window adjustment
     double STOP_WINDOW = 0.24; //stop if the difference between lower and upperbound is <= this value
-    const int STOPSCORE = 120; //if the score is higher than this for both sides, the game is consider a win
-    const int MAXPLIES = 200; //maximum game length in plies
 
     /*
      * Initialize, normally it's not needed to change anything from here
      */
     engine_t * engine = (engine_t*) engineObjPtr;
-    trans_table::disable();
     search_t * sd_root = new search_t(engine->_root_fen.c_str());
-    search_t * sd_game = new search_t(engine->_root_fen.c_str());
 
     engine->settings()->max_depth = MAXDEPTH;
     engine->settings()->init_tm(true);
@@ -422,8 +796,10 @@ void * engine_t::_learn(void * engineObjPtr) {
     double lowerBound = -score::INF;
 
     uci::silent(true);
-    trans_table::disable();
 
+    learn_match_t match;
+    int worker_count = 0;
+    learn_worker_t * workers = _learn_workers(engine, &match, worker_count);
 
     /*
      * Prepare GAMECOUNT/2 starting positions, using the opening book
@@ -432,23 +808,24 @@ void * engine_t::_learn(void * engineObjPtr) {
 
     std::cout << "\nLEARNING MODE" << std::endl;
     std::cout << "Depth: " << MAXDEPTH << std::endl;
+    std::cout << "Workers: " << worker_count << std::endl;
 
-    book_t * book = new book_t();
-    book->open("book.bin");
+    book_t * book = book::get("book.bin");
     string start_positions[MAXGAMESCOUNT + 1];
     for (int p = 0; p < MAXGAMESCOUNT + 1; p++) {
         start_positions[p] = "";
     }
+    match.engine = engine;
+    match.sd_root = sd_root;
+    match.book = book;
+    match.start_positions = start_positions;
+    match.max_depth = MAXDEPTH;
 
     /*
      * Self-play, using the generated start positions once for each side
      */
-    move_t actualmove;
-    U64 gamesPlayed = 0;
     U64 totalNodes[2] = {0, 0};
-    clock_t begin;
-    begin = clock();
-    std::string fen = "";
+    int64_t begin = time_man::now();
 
     double strongest = +bestFactor;
     double opponent = -bestFactor;
@@ -456,149 +833,23 @@ void * engine_t::_learn(void * engineObjPtr) {
     U64 step = 0;
     int maxgames = MAXGAMESCOUNT / 10;
     while ((upperBound - strongest) > STOP_WINDOW || (strongest - lowerBound) > STOP_WINDOW) {
-        int stats[3] = {0, 0, 0}; //draws, wins for learning side, losses for learning side
-        U64 nodes[2] = {0, 0}; //total node counts for both sides
         std::cout << "\nEngine(" << strongest << ") vs Engine(" << opponent << ")" << std::endl;
-        U64 batch = 0;
-        int x = 0;
-        for (int game = 0; game < maxgames; game++) {
-            //go par
-            if (x <= game) {
-                engine->_create_start_positions(sd_root, book, start_positions, x, maxgames);
-            }
-
-            fen = start_positions[game];
-            if (fen == "") {
-                upperBound = 0;
-                lowerBound = 0;
-                std::cout << "\nError: no start position (book.bin missing?)" << std::endl;
-                break;
-            }
-            sd_game->brd.init(fen.c_str());
-            int ply_count = 0;
-            int prevScore = 0;
-            bool gameover = false;
-            do {
-                for (int side_to_move = 0; side_to_move < 2; side_to_move++) {
-                    /*
-                     * Toggle learnParam to 1 or 0 to enable/disable experimental evaluation
-                     * Play each position twice: 
-                     * 1) engine(learn) vs engine(base)
-                     * 2) engine(base) vs engine(learn)
-                     */
-                    if (game % 2 == 0) {
-                        sd_game->game->learn_factor = side_to_move ? strongest : opponent;
-                    } else {
-                        sd_game->game->learn_factor = side_to_move ? opponent : strongest;
-                    }
-                    bool learning_side = sd_game->game->learn_factor == strongest;
-
-                    /*
-                     * Prepare search: cleanup and reset search stack. 
-                     */
-                    actualmove.clear();
-                    sd_game->reset_stack();
-                    int move_count = sd_game->init_root_moves();
-                    if (move_count == 0) {
-                        if (sd_game->brd.in_check()) { //current engine lost
-                            stats[1 + learning_side]++;
-                        } else {
-                            stats[0]++; //draw by stalemate. 
-                        }
-                        gameover = true;
-                        break;
-
-                    }
-                    sd_game->stack->eval_result = evaluate(sd_game);
-                    int depth = 1;
-                    int resultScore = 0;
-
-                    /*
-                     * Normal PVS search without aspiration windows
-                     */
-                    sd_game->stop_all = false;
-                    while (depth <= MAXDEPTH && !sd_game->stop_all) {
-                        int score = sd_game->pvs_root(-score::INF, score::INF, depth);
-                        if (!sd_game->stop_all) {
-                            resultScore = score;
-                        }
-                        if (sd_game->stack->pv_count > 0) {
-                            move_t firstmove = sd_game->stack->pv_moves[0];
-                            if (firstmove.piece) {
-                                actualmove.set(&firstmove);
-                            }
-                        }
-                        depth++;
-                        sd_game->root.sort_moves(&actualmove);
-                    }
-
-                    nodes[1 - learning_side] += sd_game->nodes;
-
-                    //stop conditions
-                    if (sd_game->brd.stack->fifty_count >= 20 || sd_game->brd.is_draw()) {
-                        stats[0]++; //draw
-                        gameover = true;
-                        break;
-                    }
-
-                    if (resultScore > STOPSCORE && prevScore < -STOPSCORE) {
-                        //current engine won and both engines agree
-                        stats[2 - learning_side]++;
-                        gameover = true;
-                        break;
-                    }
-
-                    if (resultScore < -STOPSCORE && prevScore > STOPSCORE) {
-                        //current engine lost and both engines agree
-                        stats[1 + learning_side]++;
-                        gameover = true;
-                        break;
-                    }
-
-                    if (ply_count >= MAXPLIES) {
-                        //too long game, abort as draw
-                        stats[0]++; //draw
-                        gameover = true;
-                        break;
-                    }
-
-                    prevScore = resultScore;
-                    ply_count++;
-                    //std::cout << ply_count << ": " << resultScore << " " << actualmove.asString() << " " << sd_game->brd.asFen() << std::endl; //for debugging
-                    sd_game->forward(&actualmove, sd_game->brd.gives_check(&actualmove));
-                }
-
-            } while (gameover == false);
-            //end go par
-            gamesPlayed++;
-            batch++;
-            if (gamesPlayed % 50 == 0) {
-                double los = 0.5 + 0.5 * erf((stats[1] - stats[2]) / sqrt(2.0 * (stats[1] + stats[2])));
-                if (los > 0.8) {
-                    std::cout << '+';
-                } else if (los < 0.2) {
-                    std::cout << '-';
-                } else {
-                    std::cout << '=';
-                }
-                std::cout.flush();
-                //check if the result if significant enough before finishing the full batch
-                if (batch > 200) {
-                    double batch_adj = MIN(0.04, batch / 100000.0);
-                    bool winner = los > (0.99 - batch_adj);
-                    bool looser = los < (0.01 + batch_adj);
-                    if (winner) {
-                        std::cout << ">";
-                        break;
-                    }
-                    if (looser) {
-                        std::cout << '<';
-                        break;
-                    }
-                }
+        match.strongest = strongest;
+        match.opponent = opponent;
+        match.max_games = maxgames;
+        _learn_match(&match, workers, worker_count);
+        if (engine->_stop_all) {
+            break;
+        }
 
-            }
+        if (match.missing_positions) {
+            upperBound = 0;
+            lowerBound = 0;
+            std::cout << "\nError: no start position (book.bin missing?)" << std::endl;
         }
+        int * stats = match.stats;
+        U64 * nodes = match.nodes;
+        U64 batch = match.batch;
         double points = stats[1] + 0.5 * stats[0];
         int maxPoints = batch;
         totalNodes[0] += nodes[0];
@@ -705,12 +956,9 @@ void * engine_t::_learn(void * engineObjPtr) {
         }
         opponent = floor(opponent * 10.0) / 10.0;
     }
-    clock_t end;
-    end = clock();
-
-    double elapsed = (1.0 + end - begin) / CLOCKS_PER_SEC;
+    double elapsed = (1.0 + time_man::now() - begin) / 1000000.0;
     std::cout << "\nElapsed: " << elapsed << "s. " << std::endl;
-    std::cout << "Games played: " << gamesPlayed << " games. (" << gamesPlayed / elapsed << " games/sec)" << std::endl;
+    std::cout << "Games played: " << match.games_played << " games. (" << match.games_played / elapsed << " games/sec)" << std::endl;
 
 
     U64 nodesSum = MAX(1, totalNodes[0] + totalNodes[1]);
@@ -722,17 +970,371 @@ void * engine_t::_learn(void * engineObjPtr) {
      */
 
     uci::silent(false);
-    trans_table::enable();
 
+    _learn_release(workers, worker_count);
+    pthread_mutex_destroy(&match.mutex);
     delete sd_root;
-    delete sd_game;
-    delete book;
 
     pthread_exit(NULL);
 
     return NULL;
 }
 
+/**
+ * SPSA tuning of a vector of integer parameters by self-play. Each iteration
+ * plays game pairs between the parameter vector perturbed in a random
+ * direction (plus) and the opposite direction (minus), then moves the vector
+ * towards the winner. The parameter file is rewritten after each iteration,
+ * so a stopped run resumes from the last completed iteration. See spsa.h for
+ * the file format.
+ * @param engineObjPtr pointer to engine object
+ * @return void
+ */
+void * engine_t::_spsa(void * engineObjPtr) {
+    engine_t * engine = (engine_t*) engineObjPtr;
+    spsa_t spsa;
+    search_t * sd_root = new search_t(engine->_root_fen.c_str());
+    bool valid = spsa.load(engine->_spsa_file);
+    for (int i = 0; valid && i < spsa.count; i++) {
+        valid = sd_root->param(spsa.params[i].name) != NULL;
+    }
+    std::cout << "\nSPSA MODE" << std::endl;
+    if (!valid) {
+        std::cout << "Error: could not read parameters from " << engine->_spsa_file << std::endl;
+        delete sd_root;
+        pthread_exit(NULL);
+        return NULL;
+    }
+
+    engine->settings()->max_depth = spsa.depth;
+    engine->settings()->init_tm(true);
+    uci::silent(true);
+
+    learn_match_t match;
+    int worker_count = 0;
+    learn_worker_t * workers = _learn_workers(engine, &match, worker_count);
+    std::string * start_positions = new std::string[2 * spsa.pairs + 1];
+    match.sd_root = sd_root;
+    match.book = book::get("book.bin");
+    match.start_positions = start_positions;
+    match.max_depth = spsa.depth;
+    match.max_games = 2 * spsa.pairs;
+    match.early_stop = false;
+    match.strongest = 1.0;
+    match.opponent = 1.0;
+    match.param_count = spsa.count;
+    for (int i = 0; i < spsa.count; i++) {
+        match.param_names[i] = spsa.params[i].name;
+    }
+    for (int i = 0; i < worker_count; i++) {
+        for (int j = 0; j < spsa.count; j++) {
+            workers[i].params[j] = workers[i].sd_game->param(match.param_names[j]);
+        }
+    }
+
+    std::cout << "Depth: " << spsa.depth << std::endl;
+    std::cout << "Workers: " << worker_count << std::endl;
+    std::cout << "Iteration: " << spsa.iteration << "/" << spsa.iterations << std::endl;
+
+    int64_t begin = time_man::now();
+    while (!spsa.done() && !engine->_stop_all) {
+        spsa.perturb(match.param_values[1], match.param_values[0]);
+        _learn_match(&match, workers, worker_count);
+        if (match.missing_positions || engine->_stop_all) {
+            break;
+        }
+        spsa.update(match.stats[1] - match.stats[2]);
+        if (!spsa.save(engine->_spsa_file)) {
+            std::cout << "\nError: could not write " << engine->_spsa_file << std::endl;
+            break;
+        }
+        std::cout << "\nIteration " << spsa.iteration << ": +" << match.stats[1]
+                << " -" << match.stats[2] << " =" << match.stats[0];
+        for (int i = 0; i < spsa.count; i++) {
+            std::cout << " " << spsa.params[i].name << " " << spsa.params[i].value;
+        }
+        std::cout << std::endl;
+    }
+
+    double elapsed = (1.0 + time_man::now() - begin) / 1000000.0;
+    std::cout << "\nElapsed: " << elapsed << "s. " << std::endl;
+    std::cout << "Games played: " << match.games_played << " games. (" << match.games_played / elapsed << " games/sec)" << std::endl;
+
+    uci::silent(false);
+    _learn_release(workers, worker_count);
+    pthread_mutex_destroy(&match.mutex);
+    delete [] start_positions;
+    delete sd_root;
+    pthread_exit(NULL);
+    return NULL;
+}
+
+/**
+ * Creates the learning workers. Each worker owns a search object, pawn and 
+ * material tables and a transposition table and evaluation cache per side, 
+ * so games are played concurrently without sharing search state and without 
+ * using the global tables. The LearnThreads option caps the amount of workers, 
+ * 0 means one worker per core.
+ * @param engine the engine
+ * @param match the match to initialize, shared by the workers
+ * @param count amount of workers created
+ * @return the workers
+ */
+learn_worker_t * engine_t::_learn_workers(engine_t * engine, learn_match_t * match, int & count) {
+    const int LEARN_HASH = 1; //size of the private transposition tables and evaluation caches in MB
+    pthread_mutex_init(&match->mutex, NULL);
+    match->engine = engine;
+    match->games_played = 0;
+    match->early_stop = true;
+    match->param_count = 0;
+    count = options::get_value("LearnThreads");
+    if (count <= 0) {
+        count = engine->cpu_count();
+    }
+    count = range(1, MAX_THREADS, count);
+    learn_worker_t * workers = new learn_worker_t[count];
+    for (int i = 0; i < count; i++) {
+        learn_worker_t * worker = &workers[i];
+        worker->match = match;
+        worker->settings.copy(engine->settings());
+        worker->sd_game = new search_t(engine->_root_fen.c_str(), &worker->settings);
+        worker->sd_game->set_thread(i);
+        worker->ttable[0] = new trans_table_t(LEARN_HASH);
+        worker->ttable[1] = new trans_table_t(LEARN_HASH);
+        worker->ecache[0] = new eval_cache::table_t(LEARN_HASH);
+        worker->ecache[1] = new eval_cache::table_t(LEARN_HASH);
+    }
+    return workers;
+}
+
+void engine_t::_learn_release(learn_worker_t * workers, int count) {
+    for (int i = 0; i < count; i++) {
+        delete workers[i].sd_game;
+        delete workers[i].ttable[0];
+        delete workers[i].ttable[1];
+        delete workers[i].ecache[0];
+        delete workers[i].ecache[1];
+    }
+    delete [] workers;
+}
+
+/**
+ * Plays a match of max_games games on all workers, the calling thread is
+ * worker 0
+ * @param match the match
+ * @param workers the workers
+ * @param count amount of workers
+ */
+void engine_t::_learn_match(learn_match_t * match, learn_worker_t * workers, int count) {
+    match->next_game = 0;
+    match->created = 0;
+    match->stats[0] = match->stats[1] = match->stats[2] = 0;
+    match->nodes[0] = match->nodes[1] = 0;
+    match->batch = 0;
+    match->stop = false;
+    match->missing_positions = false;
+    threads_t threads;
+    for (int i = 1; i < count; i++) {
+        threads.create(_learn_worker, &workers[i]);
+    }
+    _learn_worker(&workers[0]);
+    threads.stop_all();
+}
+
+/**
+ * Learning worker: plays games of the current match until it is finished
+ * @param workerObjPtr pointer to the worker
+ * @return void
+ */
+void * engine_t::_learn_worker(void * workerObjPtr) {
+    learn_worker_t * worker = (learn_worker_t *) workerObjPtr;
+    int game = 0;
+    std::string fen = "";
+    while (_learn_next(worker->match, game, fen)) {
+        U64 nodes[2] = {0, 0};
+        worker->sd_game->brd.init(fen.c_str());
+        int result = _learn_game(worker, game, nodes);
+        _learn_report(worker->match, result, nodes);
+    }
+    return NULL;
+}
+
+/**
+ * Takes the next game of the match, creating a new set of start positions 
+ * from the book when needed
+ * @param match the match
+ * @param game index of the game
+ * @param fen start position of the game
+ * @return false if the match is finished
+ */
+bool engine_t::_learn_next(learn_match_t * match, int & game, std::string & fen) {
+    pthread_mutex_lock(&match->mutex);
+    bool result = !match->stop && !match->engine->_stop_all && match->next_game < match->max_games;
+    if (result) {
+        game = match->next_game++;
+        if (match->created <= game) {
+            match->engine->_create_start_positions(match->sd_root, match->book,
+                    match->start_positions, match->created, match->max_games);
+        }
+        fen = match->start_positions[game];
+        if (fen == "") {
+            match->missing_positions = true;
+            match->stop = true;
+            result = false;
+        }
+    }
+    pthread_mutex_unlock(&match->mutex);
+    return result;
+}
+
+/**
+ * Adds the result of a game to the match. Every 50 games the progress is 
+ * shown and the match is stopped early if the result is significant enough.
+ * @param match the match
+ * @param result index in the match stats: 0 draw, 1 win or 2 loss for the learning side
+ * @param nodes node counts for both sides
+ */
+void engine_t::_learn_report(learn_match_t * match, int result, U64 * nodes) {
+    pthread_mutex_lock(&match->mutex);
+    match->stats[result]++;
+    match->nodes[0] += nodes[0];
+    match->nodes[1] += nodes[1];
+    match->games_played++;
+    match->batch++;
+    if (match->early_stop && match->games_played % 50 == 0 && !match->stop) {
+        int * stats = match->stats;
+        double los = 0.5 + 0.5 * erf((stats[1] - stats[2]) / sqrt(2.0 * (stats[1] + stats[2])));
+        if (los > 0.8) {
+            std::cout << '+';
+        } else if (los < 0.2) {
+            std::cout << '-';
+        } else {
+            std::cout << '=';
+        }
+        std::cout.flush();
+        //check if the result if significant enough before finishing the full batch
+        if (match->batch > 200) {
+            double batch_adj = MIN(0.04, match->batch / 100000.0);
+            bool winner = los > (0.99 - batch_adj);
+            bool looser = los < (0.01 + batch_adj);
+            if (winner) {
+                std::cout << ">";
+                match->stop = true;
+            }
+            if (looser) {
+                std::cout << '<';
+                match->stop = true;
+            }
+        }
+    }
+    pthread_mutex_unlock(&match->mutex);
+}
+
+/**
+ * Plays one shallow fixed depth self-play game from the current position of 
+ * the worker's search object. Each side uses its own transposition table and
+ * evaluation cache, as the sides evaluate with different parameters.
+ * @param worker the learning worker
+ * @param game index of the game, even games are started by the opponent
+ * @param nodes node counts for both sides
+ * @return index in the match stats: 0 draw, 1 win or 2 loss for the learning side
+ */
+int engine_t::_learn_game(learn_worker_t * worker, int game, U64 * nodes) {
+    const int STOPSCORE = 120; //if the score is higher than this for both sides, the game is consider a win
+    const int MAXPLIES = 200; //maximum game length in plies
+
+    learn_match_t * match = worker->match;
+    search_t * sd_game = worker->sd_game;
+    const double strongest = match->strongest;
+    const double opponent = match->opponent;
+    worker->ttable[0]->clear();
+    worker->ttable[1]->clear();
+    worker->ecache[0]->clear();
+    worker->ecache[1]->clear();
+    move_t actualmove;
+    int ply_count = 0;
+    int prevScore = 0;
+    while (true) {
+        for (int side_to_move = 0; side_to_move < 2; side_to_move++) {
+            /*
+             * Toggle learnParam to 1 or 0 to enable/disable experimental evaluation
+             * Play each position twice: 
+             * 1) engine(learn) vs engine(base)
+             * 2) engine(base) vs engine(learn)
+             */
+            bool learning_side = (game % 2 == 0) == (side_to_move == 1);
+            sd_game->game->learn_factor = learning_side ? strongest : opponent;
+            sd_game->ttable = worker->ttable[learning_side];
+            sd_game->ecache = worker->ecache[learning_side];
+            for (int i = 0; i < match->param_count; i++) {
+                *worker->params[i] = match->param_values[learning_side][i];
+            }
+
+            /*
+             * Prepare search: cleanup and reset search stack. 
+             */
+            actualmove.clear();
+            sd_game->reset_stack();
+            int move_count = sd_game->init_root_moves();
+            if (move_count == 0) {
+                if (sd_game->brd.in_check()) { //current engine lost
+                    return 1 + learning_side;
+                }
+                return 0; //draw by stalemate. 
+            }
+            sd_game->stack->eval_result = evaluate(sd_game);
+            int depth = 1;
+            int resultScore = 0;
+
+            /*
+             * Normal PVS search without aspiration windows
+             */
+            sd_game->stop_all = false;
+            while (depth <= match->max_depth && !sd_game->stop_all) {
+                int score = sd_game->pvs_root(-score::INF, score::INF, depth);
+                if (!sd_game->stop_all) {
+                    resultScore = score;
+                }
+                if (sd_game->stack->pv_count > 0) {
+                    move_t firstmove;
+                    firstmove.set(&sd_game->brd, sd_game->stack->pv_moves[0]);
+                    if (firstmove.piece) {
+                        actualmove.set(&firstmove);
+                    }
+                }
+                depth++;
+                sd_game->root.sort_moves(&actualmove);
+            }
+
+            nodes[1 - learning_side] += sd_game->nodes;
+
+            //stop conditions
+            if (sd_game->brd.stack->fifty_count >= 20 || sd_game->brd.is_draw()) {
+                return 0; //draw
+            }
+
+            if (resultScore > STOPSCORE && prevScore < -STOPSCORE) {
+                //current engine won and both engines agree
+                return 2 - learning_side;
+            }
+
+            if (resultScore < -STOPSCORE && prevScore > STOPSCORE) {
+                //current engine lost and both engines agree
+                return 1 + learning_side;
+            }
+
+            if (ply_count >= MAXPLIES) {
+                //too long game, abort as draw
+                return 0;
+            }
+
+            prevScore = resultScore;
+            ply_count++;
+            sd_game->forward(&actualmove, sd_game->brd.gives_check(&actualmove));
+        }
+    }
+}
+
 void engine_t::_create_start_positions(search_t * sd_root, book_t * book, string * poslist, int &x, const int max) {
 
     move::list_t * bookmoves = &sd_root->stack->move_list;
@@ -742,15 +1344,15 @@ void engine_t::_create_start_positions(search_t * sd_root, book_t * book, string
         gen++;
         while (sd_root->brd.ply < MAX_PLY) {
             actualmove.clear();
-            int count = book->find(&sd_root->brd, bookmoves);
+            int count = book ? book->find(&sd_root->brd, bookmoves) : 0;
             if (count > 0) {
                 int randomScore = 0;
                 for (int pickmove = 0; pickmove < 2; pickmove++) {
                     int totalScore = 0;
-                    for (move_t * bookmove = bookmoves->first; bookmove != bookmoves->last; bookmove++) {
-                        totalScore += bookmove->score;
+                    for (int i = bookmoves->first; i != bookmoves->last; i++) {
+                        totalScore += bookmoves->scores[i];
                         if (pickmove && totalScore >= randomScore) {
-                            actualmove.set(bookmove);
+                            bookmoves->get(&sd_root->brd, i, &actualmove);
                             break;
                         }
                     }
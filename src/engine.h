@@ -31,31 +31,115 @@
 #include "threadman.h"
 #include "uci_console.h"
 #include "timeman.h"
+#include "spsa.h"
 #include "version.h"
 
+class engine_t;
+
+/**
+ * Shared state of one self-play match, played by concurrent learning workers.
+ * Workers take the next game and report its result while holding the mutex.
+ */
+struct learn_match_t {
+    pthread_mutex_t mutex;
+    engine_t * engine;
+    search_t * sd_root;
+    book_t * book;
+    std::string * start_positions;
+    double strongest;
+    double opponent;
+    int max_depth;
+    int max_games;
+    int next_game;
+    int created;
+    int stats[3]; //draws, wins for learning side, losses for learning side
+    U64 nodes[2]; //total node counts for both sides
+    U64 batch;
+    U64 games_played;
+    bool stop;
+    bool early_stop; //stop when the result is significant
+    bool missing_positions;
+    int param_count;
+    std::string param_names[MAX_SPSA_PARAMS];
+    int param_values[2][MAX_SPSA_PARAMS]; //parameters for both sides, learning side is 1
+};
+
+/**
+ * A learning worker, owning its search object, game settings and a private 
+ * transposition table for each side
+ */
+struct learn_worker_t {
+    learn_match_t * match;
+    game_t settings;
+    search_t * sd_game;
+    trans_table_t * ttable[2];
+    eval_cache::table_t * ecache[2];
+    int * params[MAX_SPSA_PARAMS];
+};
+
+/**
+ * Shared state of a parallel perft. Workers take the next root move and
+ * share one lockless table with subtree node counts.
+ */
+struct perft_job_t {
+    std::string fen;
+    move_t moves[move::MAX_MOVES];
+    U64 counts[move::MAX_MOVES];
+    int move_count;
+    int next_move;
+    int depth;
+    perft_table::table_t * table;
+};
+
 class engine_t : public threads_t {
 private:
     game_t _game;
     std::string _root_fen;
+    std::string _spsa_file;
     U64 _total_nodes;
     bool _target_found;
     volatile bool _stop_all;
     volatile bool _ponder;
     move_t _result_move;
     int _result_score;
+    pool_t _pool;
+    search_t * _main;
+    search_t * _helpers[MAX_THREADS];
+    int _helper_count;
     
     static void * _think(void * engineObjPtr);
+    static void * _help(void * searchObjPtr);
     static void * _learn(void * engineObjPtr);
+    static void * _spsa(void * engineObjPtr);
+    static learn_worker_t * _learn_workers(engine_t * engine, learn_match_t * match, int & count);
+    static void _learn_release(learn_worker_t * workers, int count);
+    static void _learn_match(learn_match_t * match, learn_worker_t * workers, int count);
+    static void * _learn_worker(void * workerObjPtr);
+    static int _learn_game(learn_worker_t * worker, int game, U64 * nodes);
+    static bool _learn_next(learn_match_t * match, int & game, std::string & fen);
+    static void _learn_report(learn_match_t * match, int result, U64 * nodes);
     static void * _book_calc(void * engineObjPrt);
+    static void * _perft_worker(void * jobObjPtr);
+    static U64 _perft(board_t * brd, move::list_t * lists, int depth, perft_table::table_t * table);
     
     void _create_start_positions(search_t * root, book_t * book, std::string * pos, int &x, const int max);
+    search_t * _create_search();
+    search_t * _reuse_search(search_t * s, int thread_id);
+    void _prepare_helpers();
+    void _start_helpers();
+    void _stop_helpers();
+    search_t * _vote(search_t * s);
 
 public:
     
     engine_t();
+    ~engine_t();
     void new_game(std::string fen);
-    void copy_results(search_t * s);
+    search_t * copy_results(search_t * s);
+    U64 helper_nodes();
     void analyse();
+    U64 bench(int depth, int threads, int hash);
+    U64 perft(int depth, int threads, int hash);
     
     game_t * settings() { 
         return & _game;
@@ -68,13 +152,26 @@ public:
     bool think() {
         stop();
         _stop_all = false;
-        return this->create(_think, this);
+        return _pool.start(0, _think, this);
+    }
+
+    /**
+     * Waits until the search has finished, without stopping it
+     */
+    void wait() {
+        _pool.wait_for(0);
     }
 
     void learn() {
         _stop_all = false;
         this->create(_learn, this);
     }
+
+    void spsa(std::string file_name) {
+        _stop_all = false;
+        _spsa_file = file_name;
+        this->create(_spsa, this);
+    }
     
     void book_calc() {
         _stop_all = false;
@@ -88,6 +185,7 @@ public:
     void stop() {
         _stop_all = true;
         this->stop_all();
+        _pool.wait_for(0);
     }
 
     void set_position(std::string fen) {
@@ -131,13 +229,17 @@ namespace engine {
     void stop();
     void go();
     void analyse();
+    U64 bench(int depth, int threads, int hash);
+    U64 perft(int depth, int threads, int hash);
     void learn();
+    void spsa(std::string file_name);
     void book_calc();
     void new_game(std::string fen);
     void set_position(std::string fen);
     void set_ponder(bool ponder);
     bool is_stopped();
     bool is_ponder();
+    U64 helper_nodes();
     game_t * settings();
     engine_t * instance();
 }
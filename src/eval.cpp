@@ -68,9 +68,10 @@ const score_t TEMPO[2] = {S(-10, 0), S(10, 0)};
 /**
  * Main evaluation function (normal chess variant)
  * @param s search object
+ * @param tt_eval evaluation score from the transposition table or INVALID
  * @return total evaluation score rounded to GRAIN_SIZE 
  */
-int evaluate(search_t * s) {
+int evaluate(search_t * s, int tt_eval) {
 
     /*
      * Return immediately if in check or if a valid evaluation score is
@@ -86,6 +87,25 @@ int evaluate(search_t * s) {
         return s->stack->eval_result;
     }
 
+    /*
+     * Use the score from the transposition table or the evaluation cache if 
+     * available. The search still needs the material and pawn table entries 
+     * of this position.
+     */
+
+    if (tt_eval != score::INVALID) {
+        s->tt_evals++;
+    } else if (s->ecache && s->ecache->retrieve(s->brd.stack->tt_key, tt_eval)) {
+        s->cached_evals++;
+    }
+    if (tt_eval != score::INVALID) {
+        material::eval(s);
+        pawns::eval(s);
+        s->stack->eval_result = tt_eval;
+        s->stack->full_eval = false;
+        return tt_eval;
+    }
+
     /*
      * Calculate evaluation score. This needs to be done in the following order:
      * 1) Material balance. This also sets the game phase and material flags.
@@ -96,14 +116,25 @@ int evaluate(search_t * s) {
      * The score is interpolated between midgame and endgame value.
      */
 
+    s->evals++;
     const bool wtm = s->brd.us();
     int result = material::eval(s); //sets stack->mt->phase and material flags
     score_t * score = &s->stack->eval_score;
     score->set(TEMPO[wtm]);
     score->add(pawns::eval(s));
-    score->add(pieces::eval(s));
-    score->add(pawns::eval_passed_pawns(s, WHITE));
-    score->sub(pawns::eval_passed_pawns(s, BLACK));
+    if (s->piece_activity == 256 && s->passed_pawns == 256) {
+        score->add(pieces::eval(s));
+        score->add(pawns::eval_passed_pawns(s, WHITE));
+        score->sub(pawns::eval_passed_pawns(s, BLACK));
+    } else {
+        score_t pc_score(*pieces::eval(s));
+        score_t pp_score(*pawns::eval_passed_pawns(s, WHITE));
+        pp_score.sub(pawns::eval_passed_pawns(s, BLACK));
+        pc_score.mul256(s->piece_activity);
+        pp_score.mul256(s->passed_pawns);
+        score->add(pc_score);
+        score->add(pp_score);
+    }
     score->add(king_attack::eval(s, WHITE));
     score->sub(king_attack::eval(s, BLACK));
     result += score->get(s->stack->mt->phase);
@@ -123,6 +154,10 @@ int evaluate(search_t * s) {
 
     result = (result / GRAIN_SIZE) * GRAIN_SIZE;
     s->stack->eval_result = result;
+    s->stack->full_eval = true;
+    if (s->ecache) {
+        s->ecache->store(s->brd.stack->tt_key, result);
+    }
     assert(result > -score::DEEPEST_MATE && result < score::DEEPEST_MATE);
     return result;
 }
\ No newline at end of file
@@ -30,7 +30,7 @@
 class search_t;
 extern const score_t TEMPO[2];
 
-int evaluate(search_t * s);
+int evaluate(search_t * s, int tt_eval = score::INVALID);
 
 namespace PST {
     extern pst_t table;
@@ -46,14 +46,6 @@ namespace eg {
         return us == WHITE ? score::WIN / div : -score::WIN / div;
     }
 
-    bool has_pieces(search_t * s, bool us) {
-        return s->brd.has_pieces(us);
-    }
-
-    bool has_pawns(search_t * s, bool us) {
-        return s->brd.bb[PAWN[us]] != 0;
-    }
-
     bool has_winning_edge(search_t * s, bool us) {
         return us == WHITE ? s->stack->mt->score >= 450 :
                 s->stack->mt->score <= -450;
@@ -221,7 +213,24 @@ namespace eg {
                 && (s->stack->mt->phase == 16) == (!pcs_us && !pcs_them);
     }
 
+    /**
+     * Bonus for an unstoppable passed pawn against a lone king
+     * @return win bonus or 0 (none)
+     */
+    int unstoppable_bonus(search_t * s, const bool us) {
+        const int steps = unstoppable_pawn_steps(s, us);
+        return steps > 0 ? win(us, 3 + steps) : 0;
+    }
+
+    /**
+     * Evaluate KNPK endgame
+     */
     int knpk(search_t * s, const int score, const bool us) {
+        assert(s->brd.is_eg(KNPK, us));
+        const int bonus = unstoppable_bonus(s, us);
+        if (bonus) {
+            return score + bonus;
+        }
         const bool them = !us;
         if (s->brd.bb[PAWN[us]] & EDGE & RANK[us][7]) {
             int psq = s->brd.get_sq(PAWN[us]);
@@ -233,7 +242,11 @@ namespace eg {
         return score;
     }
 
+    /**
+     * Evaluate KBPK, KBPPK, ... endgames, also with pawns of the other side
+     */
     int kbpsk(search_t * s, const int score, const bool us) {
+        assert(s->brd.bb[PAWN[us]] && s->brd.has_one_piece(us) && is_1(s->brd.bb[BISHOP[us]]));
         const U64 queening_squares = fill_up(s->brd.bb[PAWN[us]], us) & RANK[us][8];
         const bool all_on_edge = (s->brd.bb[PAWN[us]] & ~EDGE) == 0;
         const bool them = !us;
@@ -257,9 +270,24 @@ namespace eg {
     }
 
     /**
-     * Evaluate opposite bishops with pawns endgame
+     * Evaluate KBPSK endgame (bishop and pawns vs lone king)
+     */
+    int kbpsk_vs_king(search_t * s, const int score, const bool us) {
+        const int bonus = unstoppable_bonus(s, us);
+        if (bonus) {
+            return score + bonus;
+        }
+        return kbpsk(s, score, us);
+    }
+
+    /**
+     * Evaluate bishops with pawns endgame, scaled down for opposite bishops
      */
     int opp_bishops(search_t * s, const int score, const bool us) {
+        const bool opposite = bool(s->brd.bb[WBISHOP] & WHITE_SQUARES) == bool(s->brd.bb[BBISHOP] & BLACK_SQUARES);
+        if (!opposite) {
+            return score;
+        }
         assert(s->brd.is_eg(OPP_BISHOPS, us));
         static const int PFMUL[9] = {1, 16, 32, 64, 128, 160, 192, 224, 240};
         return mul256(score, PFMUL[s->brd.count(PAWN[us])]);
@@ -395,25 +423,27 @@ namespace eg {
         return score;
     }
 
+    /**
+     * Evaluate KPK endgame: bitbase lookup
+     */
+    int kpk(search_t * s, const int score, const bool us) {
+        assert(eg_test(s, 1, 0, 0, 0, us) && is_1(s->brd.bb[PAWN[us]]));
+        const bool them = !us;
+        const bool utm = s->brd.us() == us;
+        bool won = KPK::probe(utm, s->brd.get_sq(KING[us]), s->brd.get_sq(KING[them]),
+                s->brd.get_sq(PAWN[us]), us == BLACK);
+        if (won) {
+            return score + win(us, 2);
+        }
+        return draw(score, 64);
+    }
+
     /**
      * Pawns vs lone king (case 1)
      */
     int pawns_vs_king(search_t * s, const int score, const bool us) {
         assert(eg_test(s, 1, 0, 0, 0, us));
 
-        const bool them = !us;
-
-        //KPK -> bitbase lookup
-        if (max_1(s->brd.bb[PAWN[us]])) {
-            const bool utm = s->brd.us() == us;
-            bool won = KPK::probe(utm, s->brd.get_sq(KING[us]), s->brd.get_sq(KING[them]),
-                    s->brd.get_sq(PAWN[us]), us == BLACK);
-            if (won) {
-                return score + win(us, 2);
-            }
-            return draw(score, 64);
-        }
-
         //KPSK -> case 1: any unstoppable pawn wins the game
         int steps = unstoppable_pawn_steps(s, us);
         if (steps > 0) {
@@ -466,19 +496,6 @@ namespace eg {
         return score;
     }
 
-    /**
-     * Evaluate KQPSKQ endgame
-     */
-
-    int kqpskq(search_t * s, const int score, const bool us) {
-        /*
-         * Todo: heuristics for typical wins/losses/draw cases in kqpskq endgame
-         */
-
-        //endgame tends to be drawish so lower the score a bit
-        return mul256(score, 224);
-    }
-
     /**
      * Piece(s) vs lone king (case 4)
      */
@@ -501,15 +518,7 @@ namespace eg {
         if (material::has_mating_power(s, us)) {
             return score + win(us) + corner_king(s, them);
         }
-        int steps = unstoppable_pawn_steps(s, us);
-        if (steps > 0) { //unstoppable passed pawn
-            return score + win(us, (3 + steps));
-        } else if (s->brd.is_eg(KNPK, us)) { //KNPK
-            return knpk(s, score, us);
-        } else if (s->brd.is_eg(KBPSK, us)) { //KBPK, KBPPK, ...
-            return kbpsk(s, score, us);
-        }
-        return score;
+        return score + unstoppable_bonus(s, us);
     }
 
     /**
@@ -520,10 +529,6 @@ namespace eg {
         const bool pow_us = material::has_mating_power(s, us);
         if (!pow_us) {
             return draw(score, 0);
-        } else if (s->brd.is_eg(KRKP, us)) {
-            return krkp(s, score, us);
-        } else if (s->brd.is_eg(KQKP, us)) {
-            return kqkp(s, score, us);
         }
         return score;
     }
@@ -534,11 +539,6 @@ namespace eg {
     int pcs_n_pawns_vs_pawns(search_t * s, const int score, const bool us) {
         assert(eg_test(s, 1, 1, 1, 0, us));
 
-        //wrong colored bishop ending?
-        if (is_1(s->brd.bb[BISHOP[us]] && s->brd.has_one_piece(us))) {
-            return kbpsk(s, score, us);
-        }
-
         //endgame seems very favorable: give some extra bonus
         int bonus = 20;
         if (material::has_mating_power(s, us)) {
@@ -588,8 +588,6 @@ namespace eg {
         const bool them = !us;
         if (!material::has_mating_power(s, us)) { //no mating power -> draw 
             return draw(score, 16);
-        } else if (s->brd.is_eg(KBBKN, us)) { //KBBKN is an exception
-            return score + win(us, 2) + corner_king(s, them, 2) + 20 * piece_distance(s, them);
         } else if (!has_winning_edge(s, us)) { //no winning edge -> draw
             return draw(score, 16) + corner_king(s, them, 16);
         } else if (material::has_mating_power(s, them)) { //win 
@@ -618,10 +616,6 @@ namespace eg {
         } else if (!pow_us && max_1(s->brd.bb[PAWN[us]])) {
             //they can sacrifice their piece(s) to force a draw
             return draw(score, 4);
-        } else if (s->brd.is_eg(KRPKR, us)) {
-            return krpkr(s, score, us);
-        } else if (s->brd.is_eg(KQPSKQ, us)) {
-            return kqpskq(s, score, us);
         }
         return score;
     }
@@ -653,62 +647,189 @@ namespace eg {
     /**
      * Piece(s) and pawn(s) vs piece(s) and pawn(s) (case 15)
      */
-    int pcs_n_pawns_vs_pcs_n_pawns(search_t * s, const int score, const bool us) {
-        assert(eg_test(s, 1, 1, 1, 1, us));
-        if (s->brd.is_eg(OPP_BISHOPS, us)) {
-            return opp_bishops(s, score, us);
-        } else if (s->brd.is_eg(KQPSKQPS, us)) {
-            return mul256(score, 200);
-        }
+    int pcs_n_pawns_vs_pcs_n_pawns(search_t *, const int score, const bool) {
         return score;
     }
 
+    /**
+     * Evaluate KBBKN endgame, a win with the bishop pair
+     */
+    int kbbkn(search_t * s, const int score, const bool us) {
+        if (!s->brd.has_bishop_pair(us)) {
+            return pcs_vs_pcs(s, score, us);
+        }
+        assert(s->brd.is_eg(KBBKN, us));
+        const bool them = !us;
+        return score + win(us, 2) + corner_king(s, them, 2) + 20 * piece_distance(s, them);
+    }
+
+    /**
+     * Evaluate KQPSKQ endgame
+     */
+    int kqpskq(search_t * s, const int score, const bool us) {
+        if (has_winning_edge(s, us)) {
+            return pcs_n_pawns_vs_pcs(s, score, us);
+        }
+        assert(s->brd.is_eg(KQPSKQ, us));
+
+        /*
+         * Todo: heuristics for typical wins/losses/draw cases in kqpskq endgame
+         */
+
+        //endgame tends to be drawish so lower the score a bit
+        return mul256(score, 224);
+    }
+
+    /**
+     * Evaluate KQPSKQPS endgame
+     */
+    int kqpskqps(search_t *, const int score, const bool) {
+        return mul256(score, 200);
+    }
+
+    /**
+     * The winning side has no pawns and no pieces (cases 0, 2, 8 and 10)
+     */
+    int bare_king(search_t *, const int score, const bool) {
+        return draw(score);
+    }
+
+    typedef int (*eval_t)(search_t * s, const int score, const bool us);
+
+    struct evaluator_t {
+        const char * signature;
+        eval_t eval;
+    };
+
+    const int GENERIC_COUNT = 16;
+
+    /**
+     * Registry of endgame evaluators. The generic evaluators are indexed by 
+     * the material of the winning side (us) and the other side (them). 
+     * Specialised evaluators follow, with the material signature they evaluate: 
+     * the pieces of us and then those of them, "P+" meaning one or more pawns.
+     */
+    const evaluator_t REGISTRY[] = {
+        //     1: pawns us, 2: pawns them, 4: pieces us, 8: pieces them
+        {NULL, bare_king}, //  ----- ------ vs ----- ------ (KK)
+        {NULL, pawns_vs_king}, //  pawns ------ vs ----- ------
+        {NULL, bare_king}, //  ----- ------ vs pawns ------
+        {NULL, pawns_vs_pawns}, //  pawns ------ vs pawns ------
+        {NULL, pcs_vs_king}, //  ----- pieces vs ----- ------
+        {NULL, pcs_n_pawns_vs_king}, // pawns pieces vs ----- ------
+        {NULL, pcs_vs_pawns}, //  ----- pieces vs pawns ------
+        {NULL, pcs_n_pawns_vs_pawns}, // pawns pieces vs pawns ------
+        {NULL, bare_king}, //  ----- ------ vs ----- pieces
+        {NULL, pawns_vs_pcs}, //  pawns ------ vs ----- pieces
+        {NULL, bare_king}, // ----- ------ vs pawns pieces
+        {NULL, pawns_vs_pcs_n_pawns}, // pawns ------ vs pawns pieces
+        {NULL, pcs_vs_pcs}, // ----- pieces vs ----- pieces
+        {NULL, pcs_n_pawns_vs_pcs}, // pawns pieces vs ----- pieces
+        {NULL, pcs_vs_pcs_n_pawns}, // ----- pieces vs pawns pieces
+        {NULL, pcs_n_pawns_vs_pcs_n_pawns}, // pawns pieces vs pawns pieces
+        {"KPK", kpk},
+        {"KNPK", knpk},
+        {"KBP+K", kbpsk_vs_king},
+        {"KBP+KP+", kbpsk},
+        {"KRKP", krkp},
+        {"KQKP", kqkp},
+        {"KBBKN", kbbkn},
+        {"KRPKR", krpkr},
+        {"KQP+KQ", kqpskq},
+        {"KBP+KBP+", opp_bishops},
+        {"KQP+KQP+", kqpskqps}
+    };
+
+    const int REGISTRY_SIZE = sizeof (REGISTRY) / sizeof (REGISTRY[0]);
+
+    const char SIGNATURE_PIECES[] = ".PNBRQ"; //by piece type of white
+
+    /**
+     * Material signature parsed into piece counts, indexed by side (us: 1, 
+     * them: 0) and piece type of white
+     */
+    struct signature_t {
+        int8_t count[2][WKING];
+        bool more_pawns[2];
+
+        void parse(const char * signature) {
+            memset(this, 0, sizeof (signature_t));
+            bool side = BLACK;
+            for (const char * c = signature; *c; c++) {
+                const char * pc = strchr(SIGNATURE_PIECES, *c);
+                if (*c == 'K') {
+                    side = !side; //the first king starts the pieces of us
+                } else if (*c == '+') {
+                    more_pawns[side] = true;
+                } else if (pc) {
+                    count[side][pc - SIGNATURE_PIECES]++;
+                }
+            }
+        }
+
+        bool matches(const int * n, bool us) {
+            for (int side = 0; side < 2; side++) {
+                const int offset = side == WHITE ? 0 : BPAWN - WPAWN;
+                const bool is_us = side == us;
+                for (int pc = WPAWN; pc < WKING; pc++) {
+                    const int expected = count[is_us][pc];
+                    const int actual = n[pc + offset];
+                    if (actual != expected && (pc != WPAWN || !more_pawns[is_us] || actual < expected)) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    };
+
+    /**
+     * Selects the endgame evaluator of a material configuration: the 
+     * specialised evaluator matching its signature or else the generic one. 
+     * It is stored in the material table, so it is looked up only once 
+     * per configuration.
+     * @param n piece counts, indexed by piece type (WPAWN..BQUEEN)
+     * @param us winning side
+     * @return index in the registry
+     */
+    uint8_t evaluator(const int * n, bool us) {
+        static signature_t signatures[REGISTRY_SIZE];
+        static bool parsed = false;
+        if (!parsed) {
+            for (int i = GENERIC_COUNT; i < REGISTRY_SIZE; i++) {
+                signatures[i].parse(REGISTRY[i].signature);
+            }
+            parsed = true;
+        }
+        for (int i = GENERIC_COUNT; i < REGISTRY_SIZE; i++) {
+            if (signatures[i].matches(n, us)) {
+                return i;
+            }
+        }
+        const bool them = !us;
+        const bool pawns_us = n[PAWN[us]] > 0;
+        const bool pawns_them = n[PAWN[them]] > 0;
+        const bool pieces_us = n[KNIGHT[us]] + n[BISHOP[us]] + n[ROOK[us]] + n[QUEEN[us]] > 0;
+        const bool pieces_them = n[KNIGHT[them]] + n[BISHOP[them]] + n[ROOK[them]] + n[QUEEN[them]] > 0;
+        return pawns_us + 2 * pawns_them + 4 * pieces_us + 8 * pieces_them;
+    }
+
+    /**
+     * Material signature of an evaluator
+     * @param id index in the registry
+     * @return signature, or NULL for generic evaluators
+     */
+    const char * signature(uint8_t id) {
+        assert(id < REGISTRY_SIZE);
+        return REGISTRY[id].signature;
+    }
+
     /**
      * Main endgame evaluation function
      */
     int eval(search_t * s, const int score) {
         const bool us = (score > 0) || (score == 0 && s->brd.us()); //winning side
-        const bool them = !us;
-        int eg_ix = has_pawns(s, us) + 2 * has_pawns(s, them)
-                + 4 * has_pieces(s, us) + 8 * has_pieces(s, them);
-
-        switch (eg_ix) { //1      4        2      8
-            case 0: //  ----- ------ vs ----- ------ (KK)
-                return draw(score);
-            case 1: //  pawns ------ vs ----- ------
-                return pawns_vs_king(s, score, us);
-            case 2: //  ----- ------ vs pawns ------
-                return draw(score);
-            case 3: //  pawns ------ vs pawns ------
-                return pawns_vs_pawns(s, score, us);
-            case 4: //  ----- pieces vs ----- ------
-                return pcs_vs_king(s, score, us);
-            case 5: // pawns pieces vs ----- ------
-                return pcs_n_pawns_vs_king(s, score, us);
-            case 6: //  ----- pieces vs pawns ------
-                return pcs_vs_pawns(s, score, us);
-            case 7: // pawns pieces vs pawns ------
-                return pcs_n_pawns_vs_pawns(s, score, us);
-            case 8: //  ----- ------ vs ----- pieces
-                return draw(score);
-            case 9: //  pawns ------ vs ----- pieces
-                return pawns_vs_pcs(s, score, us);
-            case 10: // ----- ------ vs pawns pieces
-                return draw(score);
-            case 11: // pawns ------ vs pawns pieces
-                return pawns_vs_pcs_n_pawns(s, score, us);
-            case 12: // ----- pieces vs ----- pieces
-                return pcs_vs_pcs(s, score, us);
-            case 13: // pawns pieces vs ----- pieces
-                return pcs_n_pawns_vs_pcs(s, score, us);
-            case 14: // ----- pieces vs pawns pieces
-                return pcs_vs_pcs_n_pawns(s, score, us);
-            case 15: // pawns pieces vs ----- pieces
-                return pcs_n_pawns_vs_pcs_n_pawns(s, score, us);
-            default:
-                assert(false);
-                return score;
-        }
-        return score;
+        assert(s->stack->mt->endgame[us] < REGISTRY_SIZE);
+        return REGISTRY[s->stack->mt->endgame[us]].eval(s, score, us);
     }
 }
@@ -29,6 +29,8 @@
 namespace eg {
     
     int eval(search_t * s, const int score);
+    uint8_t evaluator(const int * n, bool us);
+    const char * signature(uint8_t id);
     
 }
 
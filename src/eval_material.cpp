@@ -24,6 +24,7 @@
 #include "search.h"
 #include "bits.h"
 #include "score.h"
+#include "eval_endgame.h"
 
 namespace material {
 
@@ -92,37 +93,21 @@ namespace material {
     }
 
     /**
-     * Evaluate material score and set the current game phase
-     * @param sd search meta-data object
+     * Calculates the material table entry of a material configuration
+     * @param e the entry to fill
+     * @param n piece counts, indexed by piece type (WPAWN..BQUEEN)
      */
-    int eval(search_t * s) {
-
-        /*
-         * 1. Probe the material table
-         */
-
-        board_t * brd = &s->brd;
-        s->stack->mt = material_table::retrieve(brd->stack->material_hash);
-        material_table::entry_t * e = s->stack->mt;
-        if (e->key == brd->stack->material_hash) {
-            return e->score;
-        }
-        e->key = brd->stack->material_hash;
-
-        /*
-         * 2. Calculate material value and store in material hash table
-         */
-
-        const int wpawns = brd->count(WPAWN);
-        const int bpawns = brd->count(BPAWN);
-        const int wknights = brd->count(WKNIGHT);
-        const int bknights = brd->count(BKNIGHT);
-        const int wbishops = brd->count(WBISHOP);
-        const int bbishops = brd->count(BBISHOP);
-        const int wrooks = brd->count(WROOK);
-        const int brooks = brd->count(BROOK);
-        const int wqueens = brd->count(WQUEEN);
-        const int bqueens = brd->count(BQUEEN);
+    void calculate(material_table::entry_t * e, const int * n) {
+        const int wpawns = n[WPAWN];
+        const int bpawns = n[BPAWN];
+        const int wknights = n[WKNIGHT];
+        const int bknights = n[BKNIGHT];
+        const int wbishops = n[WBISHOP];
+        const int bbishops = n[BBISHOP];
+        const int wrooks = n[WROOK];
+        const int brooks = n[BROOK];
+        const int wqueens = n[WQUEEN];
+        const int bqueens = n[BQUEEN];
         const int wminors = wknights + wbishops;
         const int bminors = bknights + bbishops;
         const int wmajors = wrooks + 2 * wqueens;
@@ -215,8 +200,100 @@ namespace material {
             e->flags |= MFLAG_EG;
         }
 
+        /*
+         * Endgame evaluator for either side winning
+         */
+
+        e->endgame[WHITE] = eg::evaluator(n, WHITE);
+        e->endgame[BLACK] = eg::evaluator(n, BLACK);
+
         e->score = result;
+    }
+
+    /*
+     * Material configurations of one side in the direct table:
+     * up to 8 pawns, 2 knights, 2 bishops, 2 rooks and 1 queen
+     */
+    const int MAX_COUNT[BKING + 1] = {0, 8, 2, 2, 2, 1, 1, 8, 2, 2, 2, 1, 1};
+    const int SIDE_SIZE = 9 * 3 * 3 * 3 * 2;
+
+    material_table::entry_t _table[SIDE_SIZE * SIDE_SIZE];
+
+    /**
+     * Index of the material of one side in the direct table
+     * @param n piece counts, indexed by piece type
+     * @param us white or black
+     * @return index or -1 if the side has promoted pieces beyond the table range
+     */
+    int side_index(const int * n, bool us) {
+        const int knights = n[KNIGHT[us]];
+        const int bishops = n[BISHOP[us]];
+        const int rooks = n[ROOK[us]];
+        const int queens = n[QUEEN[us]];
+        if (knights > 2 || bishops > 2 || rooks > 2 || queens > 1) {
+            return -1;
+        }
+        return (((queens * 3 + rooks) * 3 + bishops) * 3 + knights) * 9 + n[PAWN[us]];
+    }
+
+    /**
+     * Fills the direct table once at startup. It never misses for material 
+     * in range and is shared read-only by all search threads.
+     */
+    struct table_builder_t {
+
+        table_builder_t() {
+            int n[BKING + 1] = {0};
+            n[WKING] = n[BKING] = 1;
+            for (int w = 0; w < SIDE_SIZE; w++) {
+                for (int b = 0; b < SIDE_SIZE; b++) {
+                    int wx = w, bx = b;
+                    for (int pc = WPAWN; pc <= WQUEEN; pc++) {
+                        n[pc] = wx % (MAX_COUNT[pc] + 1);
+                        wx /= MAX_COUNT[pc] + 1;
+                        n[pc + BPAWN - WPAWN] = bx % (MAX_COUNT[pc] + 1);
+                        bx /= MAX_COUNT[pc] + 1;
+                    }
+                    assert(side_index(n, WHITE) == w && side_index(n, BLACK) == b);
+                    calculate(&_table[w * SIDE_SIZE + b], n);
+                }
+            }
+        }
+    } _table_builder;
+
+    /**
+     * Evaluate material score and set the current game phase
+     * @param sd search meta-data object
+     */
+    int eval(search_t * s) {
+        board_t * brd = &s->brd;
+        int n[BKING + 1];
+        for (int pc = WPAWN; pc <= BQUEEN; pc++) {
+            n[pc] = brd->count(pc);
+        }
+
+        /*
+         * 1. Look up the direct table
+         */
+
+        const int w = side_index(n, WHITE);
+        const int b = side_index(n, BLACK);
+        if (w >= 0 && b >= 0) {
+            s->stack->mt = &_table[w * SIDE_SIZE + b];
+            return s->stack->mt->score;
+        }
+
+        /*
+         * 2. Promoted pieces: probe the material hash table, calculate on a miss
+         */
+
+        s->stack->mt = s->mtable->retrieve(brd->stack->material_hash);
+        material_table::entry_t * e = s->stack->mt;
+        if (e->key != brd->stack->material_hash) {
+            e->key = brd->stack->material_hash;
+            calculate(e, n);
+        }
         return e->score;
     }
 
-}
\ No newline at end of file
+}
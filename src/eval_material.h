@@ -24,9 +24,14 @@
 
 class search_t;
 
+namespace material_table {
+    struct entry_t;
+}
+
 namespace material {
 
     int eval(search_t * s);
+    void calculate(material_table::entry_t * e, const int * n);
     bool has_mating_power(search_t * s, bool us);
     bool has_imbalance(search_t * s, bool us);
     bool has_major_imbalance(search_t * s);
@@ -45,10 +45,11 @@ namespace pawns {
 #define trace(a,b,c) /* notn */
 #endif
 
-    const score_t ISOLATED[2] = {S(-25, -20), S(-15, -15)}; //open, closed file
-    const score_t WEAK[2] = {S(-15, -15), S(-10, -10)}; //open, closed file
-    const score_t DOUBLED = S(-10, -20);
-    const score_t BLOCKED_CENTER_PAWN = S(-15, 0);
+    //not const: tunable by the texel tool
+    score_t ISOLATED[2] = {S(-25, -20), S(-15, -15)}; //open, closed file
+    score_t WEAK[2] = {S(-15, -15), S(-10, -10)}; //open, closed file
+    score_t DOUBLED = S(-10, -20);
+    score_t BLOCKED_CENTER_PAWN = S(-15, 0);
     const int PAWN_WIDTH_EG = 5;
     const int KING_ACTIVITY = 5; //endgame score for king attacking or defending pawns
 
@@ -91,7 +92,7 @@ namespace pawns {
          */
 
         board_t * brd = &s->brd;
-        s->stack->pt = pawn_table::retrieve(brd->stack->pawn_hash);
+        s->stack->pt = s->ptable->retrieve(brd->stack->pawn_hash);
         pawn_table::entry_t * e = s->stack->pt;
         if (e->key == brd->stack->pawn_hash) {
             return &e->score;
@@ -29,6 +29,11 @@
 
 namespace pawns {
     
+    extern score_t ISOLATED[2];
+    extern score_t WEAK[2];
+    extern score_t DOUBLED;
+    extern score_t BLOCKED_CENTER_PAWN;
+
     score_t * eval(search_t * s);
     score_t * eval_passed_pawns(search_t * s, bool us);
     void print_stats();
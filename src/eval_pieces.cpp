@@ -87,14 +87,15 @@ namespace pieces {
         S(10, 0), S(-10, 0)
     };
 
-    const score_t VBISHOPPAIR = S(30, 50);
-    const score_t DEFENDED = S(5, 0);
-    const score_t ROOK_7TH = S(20, 30);
-    const score_t SEMIOPEN_FILE = S(5, 0);
-    const score_t OPEN_FILE = S(15, 5);
-    const score_t CLOSED_FILE = S(-5, -5);
-    const score_t SUPPORTED_PASSER = S(10, 20);
-    const score_t CONNECTED_ROOKS(10, 20);
+    //not const: tunable by the texel tool
+    score_t VBISHOPPAIR = S(30, 50);
+    score_t DEFENDED = S(5, 0);
+    score_t ROOK_7TH = S(20, 30);
+    score_t SEMIOPEN_FILE = S(5, 0);
+    score_t OPEN_FILE = S(15, 5);
+    score_t CLOSED_FILE = S(-5, -5);
+    score_t SUPPORTED_PASSER = S(10, 20);
+    score_t CONNECTED_ROOKS(10, 20);
     const U64 PAT_BLOCKED_CENTER = BIT(d3) | BIT(e3) | BIT(d6) | BIT(e6);
     const U64 PAT_BACKRANKS[2] = {RANK_1 | RANK_2, RANK_7 | RANK_8};
     const U64 PAT_TRAPPED[2] = {(RANK_1 | RANK_2 | RANK_3) & EDGE, (RANK_6 | RANK_7 | RANK_8) & EDGE};
@@ -111,7 +112,8 @@ namespace pieces {
         board_t * brd = &s->brd;
         const bool equal_pawns = brd->ply > 0
                 && brd->stack->pawn_hash == (brd->stack - 1)->pawn_hash
-                && score::is_valid((s->stack - 1)->eval_result);
+                && score::is_valid((s->stack - 1)->eval_result)
+                && (s->stack - 1)->full_eval;
         const int prev_pc = equal_pawns ? (s->stack - 1)->current_move.capture : 0;
         const int prev_cap = equal_pawns ? (s->stack - 1)->current_move.piece : 0;
         pawn_table::entry_t * pi = s->stack->pt;
@@ -26,6 +26,15 @@ class search_t;
 class score_t;
 
 namespace pieces {
+    extern score_t VBISHOPPAIR;
+    extern score_t DEFENDED;
+    extern score_t ROOK_7TH;
+    extern score_t SEMIOPEN_FILE;
+    extern score_t OPEN_FILE;
+    extern score_t CLOSED_FILE;
+    extern score_t SUPPORTED_PASSER;
+    extern score_t CONNECTED_ROOKS;
+
     score_t * eval(search_t * s);
 }
 
@@ -26,7 +26,12 @@ namespace options {
     option_t PARAM[length+1] = {
         { "", INT, 0, ""}, //dummy value
         { "Revision", STRING, 1, "type string default " MAXIMA_REVISION },
-        { "Hash", INT, 256, "type spin default 256 min 0 max 1024"},
+        { "Hash", INT, 256, "type spin default 256 min 0 max 65536"},
+        { "Threads", INT, 1, "type spin default 1 min 1 max 128"},
+        { "PawnHash", INT, 64, "type spin default 64 min 1 max 1024"},
+        { "MaterialHash", INT, 8, "type spin default 8 min 1 max 1024"},
+        { "LearnThreads", INT, 0, "type spin default 0 min 0 max 128"},
+        { "MultiPV", INT, 1, "type spin default 1 min 1 max 32"},
         { "Ponder", BOOL, 1, "type check default true"},
         { "OwnBook", BOOL, 1, "type check default true" },
         { "UCI_AnalyseMode", BOOL, 0, "type check default false" },
@@ -40,7 +45,9 @@ namespace options {
         { "Wild", STRING, 0, "type combo default standard var standard var losers" },
         { "DrawContempt", INT, -10, "type spin default -10 min -100 max 100" },
         { "KingAttackShelter", INT, 256, "type spin default 256 min 0 max 512" },
-        { "KingAttackPieces", INT, 256, "type spin default 256 min 0 max 512" }
+        { "KingAttackPieces", INT, 256, "type spin default 256 min 0 max 512" },
+        { "PieceActivity", INT, 256, "type spin default 256 min 0 max 512" },
+        { "PassedPawns", INT, 256, "type spin default 256 min 0 max 512" }
     };
     
     option_t * get_option(const char * key) {
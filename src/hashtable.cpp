@@ -19,7 +19,11 @@
  * Implementing the main hash table, material (imbalance) table and pawn hash table
  */
 
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
 #include "hashtable.h"
+#include "timeman.h"
 
 
 namespace material_table {
@@ -46,18 +50,61 @@ namespace material_table {
         clear();
     }
 
-    table_t _global_table(TABLE_SIZE);
-
-    entry_t * retrieve(U64 key) {
-        return _global_table.retrieve(key);
+    int _size_in_mb = TABLE_SIZE;
+    table_t * _tables[MAX_THREADS] = {NULL};
+    pthread_mutex_t _tables_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    /**
+     * Gets the table of a search thread, allocating it on first use. Search
+     * threads and learning workers may ask for their tables concurrently,
+     * so the table array is only touched under a mutex.
+     * @param thread_id search thread index
+     * @return table
+     */
+    table_t * instance(int thread_id) {
+        assert(thread_id >= 0 && thread_id < MAX_THREADS);
+        pthread_mutex_lock(&_tables_mutex);
+        if (_tables[thread_id] == NULL) {
+            _tables[thread_id] = new table_t(_size_in_mb);
+        }
+        table_t * result = _tables[thread_id];
+        pthread_mutex_unlock(&_tables_mutex);
+        return result;
     }
 
     void clear() {
-        _global_table.clear();
+        pthread_mutex_lock(&_tables_mutex);
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (_tables[i]) {
+                _tables[i]->clear();
+            }
+        }
+        pthread_mutex_unlock(&_tables_mutex);
     }
 
     void set_size(int size_in_mb) {
-        _global_table.set_size(size_in_mb);
+        pthread_mutex_lock(&_tables_mutex);
+        _size_in_mb = size_in_mb;
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (_tables[i]) {
+                _tables[i]->set_size(size_in_mb);
+            }
+        }
+        pthread_mutex_unlock(&_tables_mutex);
+    }
+
+    /**
+     * Sums the counters of all tables
+     */
+    void stats(hash_stats_t & total) {
+        total.clear();
+        pthread_mutex_lock(&_tables_mutex);
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (_tables[i]) {
+                total.add(_tables[i]->stats);
+            }
+        }
+        pthread_mutex_unlock(&_tables_mutex);
     }
 };
 
@@ -86,18 +133,128 @@ namespace pawn_table {
     }
 
 
+    int _size_in_mb = TABLE_SIZE;
+    table_t * _tables[MAX_THREADS] = {NULL};
+    pthread_mutex_t _tables_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+    /**
+     * Gets the table of a search thread, allocating it on first use. Search
+     * threads and learning workers may ask for their tables concurrently,
+     * so the table array is only touched under a mutex.
+     * @param thread_id search thread index
+     * @return table
+     */
+    table_t * instance(int thread_id) {
+        assert(thread_id >= 0 && thread_id < MAX_THREADS);
+        pthread_mutex_lock(&_tables_mutex);
+        if (_tables[thread_id] == NULL) {
+            _tables[thread_id] = new table_t(_size_in_mb);
+        }
+        table_t * result = _tables[thread_id];
+        pthread_mutex_unlock(&_tables_mutex);
+        return result;
+    }
+
+    void clear() {
+        pthread_mutex_lock(&_tables_mutex);
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (_tables[i]) {
+                _tables[i]->clear();
+            }
+        }
+        pthread_mutex_unlock(&_tables_mutex);
+    }
+
+    void set_size(int size_in_mb) {
+        pthread_mutex_lock(&_tables_mutex);
+        _size_in_mb = size_in_mb;
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (_tables[i]) {
+                _tables[i]->set_size(size_in_mb);
+            }
+        }
+        pthread_mutex_unlock(&_tables_mutex);
+    }
+
+    /**
+     * Sums the counters of all tables
+     */
+    void stats(hash_stats_t & total) {
+        total.clear();
+        pthread_mutex_lock(&_tables_mutex);
+        for (int i = 0; i < MAX_THREADS; i++) {
+            if (_tables[i]) {
+                total.add(_tables[i]->stats);
+            }
+        }
+        pthread_mutex_unlock(&_tables_mutex);
+    }
+};
+
+namespace eval_cache {
+
+    table_t::table_t(int size_in_MB) {
+        U64 max_entries = (U64(MAX(1, size_in_MB)) * 1024 * 1024) / sizeof (U64);
+        size = U64(1) << bsr(max_entries);
+        max_hash_key = size - 1;
+        table = new U64[size];
+        clear();
+    }
+
     table_t _global_table(TABLE_SIZE);
 
-    entry_t * retrieve(U64 key) {
-        return _global_table.retrieve(key);
+    /**
+     * The cache shared by all search threads
+     */
+    table_t * instance() {
+        return &_global_table;
     }
 
     void clear() {
         _global_table.clear();
     }
+};
 
-    void set_size(int size_in_mb) {
-        _global_table.set_size(size_in_mb);
+namespace perft_table {
+
+    table_t::table_t(int size_in_MB) {
+        U64 max_entries = (U64(MAX(1, size_in_MB)) * 1024 * 1024) / sizeof (entry_t);
+        size = U64(1) << bsr(max_entries);
+        max_hash_key = size - 1;
+        table = new entry_t[size];
+        memset(table, 0, sizeof (entry_t) * size);
+    }
+
+    /**
+     * Stores a subtree node count, see trans_table_t::store
+     */
+    void table_t::store(U64 key, int depth, U64 count) {
+        assert(depth > 0 && depth <= 255);
+        const U64 value = (count << 8) | depth;
+        entry_t * entry = &table[index(key)];
+        const U64 entry_value = __atomic_load_n(&entry->value, __ATOMIC_RELAXED);
+        if (int(entry_value & 255) > depth) {
+            entry++;
+        }
+        __atomic_store_n(&entry->value, value, __ATOMIC_RELAXED);
+        __atomic_store_n(&entry->key, value ^ key, __ATOMIC_RELAXED);
+    }
+
+    /**
+     * Retrieves a subtree node count for a position and depth
+     * @return true if found
+     */
+    bool table_t::retrieve(U64 key, int depth, U64 & count) {
+        entry_t * bucket = &table[index(key)];
+        for (int i = 0; i < 2; i++) {
+            const U64 entry_key = __atomic_load_n(&bucket[i].key, __ATOMIC_RELAXED);
+            const U64 entry_value = __atomic_load_n(&bucket[i].value, __ATOMIC_RELAXED);
+            if ((entry_key ^ entry_value) == key && int(entry_value & 255) == depth) {
+                count = entry_value >> 8;
+                return true;
+            }
+        }
+        return false;
     }
 };
 
@@ -118,25 +275,149 @@ namespace rep_table {
 
 trans_table_t::trans_table_t(int size_in_MB) {
     table = NULL;
+    mapped = NULL;
+    mapped_bytes = 0;
+    huge_pages = false;
     enabled = true;
+    clear_ms = -1;
     size_in_mb = -1;
     set_size(size_in_MB);
 }
 
-void trans_table_t::set_size(int size_in_MB) {
+/**
+ * Resizes the table to the largest power of two amount of buckets that fits 
+ * in size_in_MB. If the memory is not available, the size is halved until 
+ * the allocation succeeds.
+ * @param size_in_MB size in megabytes
+ * @param pool worker threads clearing the new table, or NULL
+ */
+void trans_table_t::set_size(int size_in_MB, pool_t * pool) {
+    assert(sizeof (bucket_t) == CACHE_LINE);
     if (size_in_mb == size_in_MB) {
         return;
     }
-    if (table) {
-        delete[] table;
+    release();
+    U64 max_buckets = (U64(size_in_MB) << 20) / sizeof (bucket_t);
+    U64 buckets = U64(1) << (max_buckets ? bsr(max_buckets) : 0);
+    while (!allocate(buckets) && buckets > 1) {
+        buckets >>= 1;
     }
-    int entry_size = sizeof (entry_t);
-    int max_entries = (size_in_MB * 1024 * 1024) / entry_size;
-    size = 1 << (max_entries ? bsr(max_entries) : 0);
-    table = new entry_t[size];
+    assert(table != NULL);
+    size = buckets;
     max_hash_key = size - 1;
     size_in_mb = size_in_MB;
-    clear();
+    clear(pool);
+}
+
+/**
+ * Allocates the table with mmap. Tables of at least one huge page are aligned 
+ * to the huge page size and advised to be backed by transparent huge pages, 
+ * which reduces TLB misses on random probes.
+ * @param buckets amount of buckets
+ * @return true if successful
+ */
+bool trans_table_t::allocate(U64 buckets) {
+    const U64 bytes = buckets * sizeof (bucket_t);
+    const bool huge = bytes >= HUGE_PAGE;
+    const U64 alignment = huge ? HUGE_PAGE : CACHE_LINE;
+    mapped_bytes = bytes + alignment;
+    mapped = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        mapped = NULL;
+        mapped_bytes = 0;
+        return false;
+    }
+    U64 address = ((U64) mapped + alignment - 1) & ~(alignment - 1);
+    table = (bucket_t *) address;
+    huge_pages = false;
+#ifdef MADV_HUGEPAGE
+    if (huge) {
+        huge_pages = madvise(table, bytes, MADV_HUGEPAGE) == 0;
+    }
+#endif
+    return true;
+}
+
+void trans_table_t::release() {
+    if (mapped) {
+        munmap(mapped, mapped_bytes);
+    }
+    mapped = NULL;
+    mapped_bytes = 0;
+    table = NULL;
+}
+
+/**
+ * Clears the table. Large tables are cleared by one pool worker per search 
+ * thread (Threads option), each zeroing a contiguous part. The workers are the 
+ * ones that run the searches, so on a freshly mapped table this first touch 
+ * spreads the pages over the NUMA nodes of the threads that will use them.
+ * The pool must be idle: the table is not cleared while searching.
+ * @param pool worker threads, or NULL to clear on the calling thread
+ */
+void trans_table_t::clear(pool_t * pool) {
+    const int64_t begin = time_man::now();
+    const U64 max_count = MAX(1, size_in_bytes() / MIN_CLEAR_CHUNK);
+    const int count = MIN(U64(range(1, MAX_THREADS, options::get_value("Threads"))), max_count);
+    clear_chunk_t chunks[MAX_THREADS];
+    for (int i = 0; i < count; i++) {
+        chunks[i].first = table + size * i / count;
+        chunks[i].count = size * (i + 1) / count - size * i / count;
+        if (i == count - 1 || pool == NULL || !pool->start(i, _clear_chunk, &chunks[i])) {
+            _clear_chunk(&chunks[i]);
+        }
+    }
+    for (int i = 0; pool && i < count - 1; i++) {
+        pool->wait_for(i);
+    }
+    for (int i = 0; i < MAX_THREADS; i++) {
+        _stats[i].clear();
+    }
+    clear_ms = (time_man::now() - begin) / 1000;
+}
+
+void * trans_table_t::_clear_chunk(void * chunk_p) {
+    clear_chunk_t * chunk = (clear_chunk_t *) chunk_p;
+    memset(chunk->first, 0, sizeof (bucket_t) * chunk->count);
+    return NULL;
+}
+
+/**
+ * Page size backing the table: the huge page size if the kernel actually 
+ * backs (part of) the table with transparent huge pages. A successful 
+ * madvise is only a request, so this is checked in /proc/self/smaps.
+ * @return page size in bytes
+ */
+int trans_table_t::page_size() {
+    if (huge_pages && huge_page_bytes() > 0) {
+        return HUGE_PAGE;
+    }
+    return sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Amount of the table backed by transparent huge pages, read from the 
+ * AnonHugePages field of the mapping containing the table
+ * @return size in bytes, 0 if none or unknown
+ */
+U64 trans_table_t::huge_page_bytes() {
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    const U64 address = (U64) table;
+    bool in_table = false;
+    while (std::getline(smaps, line)) {
+        std::istringstream fields(line);
+        U64 begin, end;
+        char dash;
+        if (fields >> std::hex >> begin >> dash >> end && dash == '-') {
+            in_table = address >= begin && address < end;
+        } else if (in_table && line.compare(0, 14, "AnonHugePages:") == 0) {
+            U64 kb = 0;
+            std::istringstream(line.substr(14)) >> kb;
+            return kb << 10;
+        }
+    }
+    return 0;
 }
 
 int trans_table_t::make_score(int score, int ply) {
@@ -157,25 +438,33 @@ int trans_table_t::unmake_score(int score, int ply) {
     return score;
 }
 
-void trans_table_t::store(U64 key, int age, int ply, int depth, int score, int move, int flags) {
+/**
+ * Stores an entry. Entries are published without locking: other threads
+ * see either the old or the new entry, or a torn entry that fails the key check.
+ * @param thread_id search thread, selecting its own counters
+ */
+void trans_table_t::store(U64 key, int age, int ply, int depth, int score, int move, int flags, int eval, int thread_id) {
     assert(depth > 0);
+    assert(thread_id >= 0 && thread_id < MAX_THREADS);
+    hash_stats_t & stats = _stats[thread_id];
+    stats.stores++;
     entry_t * best_entry = NULL;
     int best_score = -score::INF;
     age = age % 64;
     score = make_score(score, ply);
-    U64 value = encode(age, depth, score, move, flags);
-    int ix = index(key);
-    int bix = ix;
+    U64 value = encode(age, depth, score, move, flags, eval);
+    bucket_t & bucket = table[index(key)];
     for (int i = 0; i < BUCKETS; i++) {
-        bix = (ix + i) & max_hash_key;
-        entry_t & entry = table[bix];
-        if ((entry.key ^ entry.value) == key) { //overwrite; note the entry did not work anyway)  
-            entry.value = value;
-            entry.key = value ^ key;
-            return;
+        entry_t & entry = bucket.entries[i];
+        const U64 entry_key = __atomic_load_n(&entry.key, __ATOMIC_RELAXED);
+        const U64 entry_value = __atomic_load_n(&entry.value, __ATOMIC_RELAXED);
+        if ((entry_key ^ entry_value) == key) { //overwrite; note the entry did not work anyway)  
+            best_entry = &entry;
+            best_score = -score::INF;
+            break;
         }
-        int s = 256 - decode_depth(entry.value);
-        int age_diff = age - decode_age(entry.value);
+        int s = 256 - decode_depth(entry_value);
+        int age_diff = age - decode_age(entry_value);
         if (age_diff > 0) {
             s += age_diff * 256;
         } else if (age_diff < 0) {
@@ -186,51 +475,140 @@ void trans_table_t::store(U64 key, int age, int ply, int depth, int score, int m
             best_entry = &entry;
         }
     }
-    //no match; store in bucket with 1) oldest age and 2) lowest depth
+    //store in the matching entry, or in the entry with 1) oldest age and 2) lowest depth
     assert(best_entry != NULL);
-    best_entry->value = value;
-    best_entry->key = value ^ key;
+    if (best_score > -score::INF && __atomic_load_n(&best_entry->value, __ATOMIC_RELAXED)) {
+        stats.overwrites++;
+    }
+    __atomic_store_n(&best_entry->value, value, __ATOMIC_RELAXED);
+    __atomic_store_n(&best_entry->key, value ^ key, __ATOMIC_RELAXED);
 }
 
-bool trans_table_t::retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags) {
+/**
+ * Retrieves an entry. Key and value are read exactly once, so the value 
+ * that passed the key check is the value that is decoded.
+ * @param thread_id search thread, selecting its own counters
+ */
+bool trans_table_t::retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags, int & eval, int thread_id) {
     assert(depth >= 0);
+    assert(thread_id >= 0 && thread_id < MAX_THREADS);
     move = 0;
+    eval = score::INVALID;
     if (enabled) {
-        int ix = index(key);
-        int bix = ix;
+        hash_stats_t & stats = _stats[thread_id];
+        stats.probes++;
+        int occupied = 0;
+        bucket_t & bucket = table[index(key)];
         for (int i = 0; i < BUCKETS; i++) {
-            bix = (ix + i) & max_hash_key;
-            entry_t & entry = table[bix];
-            if ((entry.key ^ entry.value) == key) {
-                move = decode_move(entry.value);
-                score = unmake_score(decode_score(entry.value), ply);
-                flags = decode_flag(entry.value);
-                int entry_depth = decode_depth(entry.value);
+            entry_t & entry = bucket.entries[i];
+            const U64 entry_key = __atomic_load_n(&entry.key, __ATOMIC_RELAXED);
+            const U64 entry_value = __atomic_load_n(&entry.value, __ATOMIC_RELAXED);
+            occupied += entry_value != 0;
+            if ((entry_key ^ entry_value) == key) {
+                stats.hits++;
+                move = decode_move(entry_value);
+                eval = decode_eval(entry_value);
+                score = unmake_score(decode_score(entry_value), ply);
+                flags = decode_flag(entry_value);
+                int entry_depth = decode_depth(entry_value);
                 return entry_depth >= depth;
             }
         }
+        stats.collisions += occupied == BUCKETS;
     }
     return false;
 }
 
+/**
+ * Sums the counters of all search threads
+ */
+void trans_table_t::stats(hash_stats_t & total) {
+    total.clear();
+    for (int i = 0; i < MAX_THREADS; i++) {
+        total.add(_stats[i]);
+    }
+}
+
+/**
+ * Estimates the table usage by sampling the first 1000 entries, as reported 
+ * by the UCI hashfull field. Only entries of the current search count.
+ * @param age root ply of the search, see store
+ * @return used entries in permille
+ */
+int trans_table_t::hashfull(int age) {
+    const int samples = MIN(U64(1000 / BUCKETS), size);
+    int result = 0;
+    age = age % 64;
+    for (int i = 0; i < samples; i++) {
+        for (int j = 0; j < BUCKETS; j++) {
+            const U64 value = __atomic_load_n(&table[i].entries[j].value, __ATOMIC_RELAXED);
+            result += value != 0 && decode_age(value) == age;
+        }
+    }
+    return result * 1000 / (samples * BUCKETS);
+}
+
 namespace trans_table {
 
     trans_table_t _global_table(TABLE_SIZE);
+    pool_t * _pool = NULL;
 
-    void store(U64 key, int age, int ply, int depth, int score, int move, int flag) {
-        _global_table.store(key, age, ply, depth, score, move, flag);
+    /**
+     * The table shared by all search threads
+     */
+    trans_table_t * instance() {
+        return &_global_table;
     }
 
-    bool retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags) {
-        return _global_table.retrieve(key, ply, depth, score, move, flags);
+    void store(U64 key, int age, int ply, int depth, int score, int move, int flag, int eval, int thread_id) {
+        _global_table.store(key, age, ply, depth, score, move, flag, eval, thread_id);
+    }
+
+    void prefetch(U64 key) {
+        _global_table.prefetch(key);
+    }
+
+    bool retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags, int & eval, int thread_id) {
+        return _global_table.retrieve(key, ply, depth, score, move, flags, eval, thread_id);
     }
 
     void clear() {
-        _global_table.clear();
+        _global_table.clear(_pool);
     }
 
     void set_size(int size_in_mb) {
-        _global_table.set_size(size_in_mb);
+        _global_table.set_size(size_in_mb, _pool);
+    }
+
+    /**
+     * Sets the worker threads used to clear the table
+     * @param pool the engine's worker pool, or NULL
+     */
+    void set_pool(pool_t * pool) {
+        _pool = pool;
+    }
+
+    /**
+     * Describes the table size, the page size backing it and how much of it
+     * the kernel has put in huge pages
+     * @return description
+     */
+    std::string info() {
+        std::ostringstream result;
+        result << "hash " << (_global_table.size_in_bytes() >> 20) << " MB, page size "
+                << (_global_table.page_size() >> 10) << " kB, "
+                << (_global_table.huge_page_bytes() >> 20) << " MB in huge pages";
+        return result.str();
+    }
+
+    /**
+     * Time spent on the last clear, reported only once
+     * @return time in milliseconds or -1 if not cleared since the last call
+     */
+    int clear_time() {
+        int result = _global_table.clear_ms;
+        _global_table.clear_ms = -1;
+        return result;
     }
 
     void enable() {
@@ -240,4 +618,12 @@ namespace trans_table {
     void disable() {
         _global_table.enabled = false;
     }
+
+    void stats(hash_stats_t & total) {
+        _global_table.stats(total);
+    }
+
+    int hashfull(int age) {
+        return _global_table.hashfull(age);
+    }
 };
\ No newline at end of file
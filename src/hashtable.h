@@ -27,6 +27,32 @@
 #include "board.h"
 #include "score.h"
 #include "game.h"
+#include "threadman.h"
+#include <sys/mman.h>
+
+/**
+ * Hash table counters. The counters of a table shared by the search threads
+ * are kept per thread, each on its own cache line, and summed when reported.
+ */
+struct hash_stats_t {
+    U64 probes;
+    U64 hits;
+    U64 stores;
+    U64 overwrites; //stores replacing an entry of another position
+    U64 collisions; //missed probes finding only entries of other positions
+
+    void clear() {
+        probes = hits = stores = overwrites = collisions = 0;
+    }
+
+    void add(const hash_stats_t & stats) {
+        probes += stats.probes;
+        hits += stats.hits;
+        stores += stats.stores;
+        overwrites += stats.overwrites;
+        collisions += stats.collisions;
+    }
+} __attribute__((aligned(64)));
 
 namespace material_table {
 
@@ -38,6 +64,7 @@ namespace material_table {
         uint8_t phase; 
         uint8_t attack_force[2];
         uint8_t flags;
+        uint8_t endgame[2]; //endgame evaluator for each winning side, see eg::eval
     };
 
     class table_t {
@@ -52,6 +79,8 @@ namespace material_table {
         }
 
     public:
+        hash_stats_t stats;
+
         table_t(int size_in_MB);
         void set_size(int size_in_MB);
 
@@ -61,17 +90,39 @@ namespace material_table {
 
         void clear() {
             memset(table, 0, sizeof (entry_t) * size);
+            stats.clear();
         }
 
+        void prefetch(U64 key) {
+            __builtin_prefetch(&table[index(key)]);
+        }
+
+        /**
+         * Gets the entry of a key. On a miss the caller fills the entry,
+         * so a miss is counted as a store as well.
+         */
         entry_t * retrieve(U64 key) {
-            return &table[index(key)];
+            entry_t * result = &table[index(key)];
+            stats.probes++;
+            if (result->key == key) {
+                stats.hits++;
+            } else {
+                stats.stores++;
+                if (result->key) {
+                    stats.collisions++;
+                    stats.overwrites++;
+                }
+            }
+            return result;
         }
 
     };
 
-    entry_t * retrieve(U64 key);
+    //one table per search thread
+    table_t * instance(int thread_id);
     void clear();
     void set_size(int size_in_MB);
+    void stats(hash_stats_t & total);
 };
 
 
@@ -110,6 +161,8 @@ namespace pawn_table {
         }
 
     public:
+        hash_stats_t stats;
+
         table_t(int size_in_MB);
         void set_size(int size_in_MB);
 
@@ -119,19 +172,136 @@ namespace pawn_table {
 
         void clear() {
             memset(table, 0, sizeof (entry_t) * size);
+            stats.clear();
         }
 
+        void prefetch(U64 key) {
+            __builtin_prefetch(&table[index(key)]);
+        }
+
+        /**
+         * Gets the entry of a key. On a miss the caller fills the entry,
+         * so a miss is counted as a store as well.
+         */
         entry_t * retrieve(U64 key) {
-            return &table[index(key)];
+            entry_t * result = &table[index(key)];
+            stats.probes++;
+            if (result->key == key) {
+                stats.hits++;
+            } else {
+                stats.stores++;
+                if (result->key) {
+                    stats.collisions++;
+                    stats.overwrites++;
+                }
+            }
+            return result;
         }
 
     };
 
-    //global access
-    entry_t * retrieve(U64 key);
+    //one table per search thread
+    table_t * instance(int thread_id);
     void clear();
     void set_size(int size_in_mb);
+    void stats(hash_stats_t & total);
+
+};
+
+namespace eval_cache {
+
+    const int TABLE_SIZE = 16; //MB
+
+    /**
+     * Lossy evaluation cache, shared by the search threads. An entry is one
+     * 64 bit word holding the upper 48 bits of the key and the evaluation
+     * score, so it is read and written as a whole and can not be torn.
+     * New scores always replace the old ones.
+     */
+    class table_t {
+    private:
+        static const U64 SCORE_MASK = 0x0FFFF;
+
+        U64 size;
+        U64 max_hash_key;
+        U64 * table;
 
+        U64 index(U64 hash_code) {
+            return hash_code & max_hash_key;
+        }
+
+    public:
+        table_t(int size_in_MB);
+
+        ~table_t() {
+            delete [] table;
+        }
+
+        void clear() {
+            memset(table, 0, sizeof (U64) * size);
+        }
+
+        void prefetch(U64 key) {
+            __builtin_prefetch(&table[index(key)]);
+        }
+
+        void store(U64 key, int score) {
+            const U64 entry = (key & ~SCORE_MASK) | (uint16_t) score;
+            __atomic_store_n(&table[index(key)], entry, __ATOMIC_RELAXED);
+        }
+
+        bool retrieve(U64 key, int & score) {
+            const U64 entry = __atomic_load_n(&table[index(key)], __ATOMIC_RELAXED);
+            if (((entry ^ key) & ~SCORE_MASK) != 0) {
+                return false;
+            }
+            score = (int16_t) (entry & SCORE_MASK);
+            return true;
+        }
+    };
+
+    //one table shared by all search threads
+    table_t * instance();
+    void clear();
+};
+
+namespace perft_table {
+    const int TABLE_SIZE = 64; //MB, default of the perft command
+
+    /**
+     * Lockless entry: the key is stored as key ^ value. The value holds the
+     * node count (upper 56 bits) and the depth (lower 8 bits).
+     */
+    struct entry_t {
+        U64 key;
+        U64 value;
+    };
+
+    /**
+     * Table with subtree node counts, shared by the perft threads. Buckets 
+     * hold two entries: the first one is replaced by deeper subtrees only, 
+     * the second one always.
+     */
+    class table_t {
+    private:
+        U64 size;
+        U64 max_hash_key;
+        entry_t * table;
+
+        U64 index(U64 hash_code) {
+            return hash_code & max_hash_key & ~U64(1);
+        }
+
+    public:
+        table_t(int size_in_MB);
+
+        ~table_t() {
+            delete [] table;
+        }
+
+        void store(U64 key, int depth, U64 count);
+        bool retrieve(U64 key, int depth, U64 & count);
+    };
 };
 
 namespace rep_table {
@@ -143,38 +313,75 @@ class trans_table_t {
 private:
 
     static const int BUCKETS = 4;
+    static const int CACHE_LINE = 64;
+    static const U64 HUGE_PAGE = 2 * 1024 * 1024;
+    static const U64 MIN_CLEAR_CHUNK = 16 * 1024 * 1024;
 
+    /**
+     * Lockless entry: the key is stored as key ^ value. An entry written
+     * concurrently by two threads (a torn entry) fails the key check.
+     */
     struct entry_t {
         U64 key;
         U64 value;
     };
 
-    int size_in_mb;
-    int size;
-    int max_hash_key;
-    entry_t * table;
+    /**
+     * Bucket of entries, fitting exactly one cache line
+     */
+    struct bucket_t {
+        entry_t entries[BUCKETS];
+    } __attribute__((aligned(CACHE_LINE)));
 
-    int index(U64 hash_code) {
+    int size_in_mb;
+    U64 size;
+    U64 max_hash_key;
+    bucket_t * table;
+    void * mapped;
+    U64 mapped_bytes;
+    bool huge_pages;
+    hash_stats_t _stats[MAX_THREADS];
+
+    U64 index(U64 hash_code) {
         return hash_code & max_hash_key;
     }
 
+    bool allocate(U64 buckets);
+    void release();
+
     /**
-     * Encodes ply, depth, score, flag and move into single U64 integer
-     * 0..31 | 32..33 (flag)        | 34..49 | 50..57 | 58..63
-     * move  | up=1, low=2, exact=3 | score  | depth  | age (using root ply)
+     * Part of the table to be cleared by one thread
      */
-    U64 encode(int age, int depth, int score, int move, int flag) {
+    struct clear_chunk_t {
+        bucket_t * first;
+        U64 count;
+    };
+
+    static void * _clear_chunk(void * chunk_p);
+
+    /**
+     * Encodes ply, depth, score, flag, move and static evaluation into single U64 integer
+     * 0..15 | 16..31 | 32..33 (flag)        | 34..49 | 50..57 | 58..63
+     * move  | eval   | up=1, low=2, exact=3 | score  | depth  | age (using root ply)
+     */
+    U64 encode(int age, int depth, int score, int move, int flag, int eval) {
         assert(age >= 0 && age <= 63);
         assert(depth >= 0 && depth <= 255);
         assert(score < score::INF);
         assert(score > -score::INF);
         assert(flag >= 0 && flag <= 3);
-        U64 result = move | (U64(flag) << 32) | (U64((unsigned short) score) << 34) | (U64(depth) << 50) | (U64(age) << 58);
+        assert(move >= 0 && move <= 0xFFFF);
+        assert(eval == score::INVALID || (eval > -score::DEEPEST_MATE && eval < score::DEEPEST_MATE));
+        U64 result = move | (U64((unsigned short) eval) << 16) | (U64(flag) << 32) | (U64((unsigned short) score) << 34) | (U64(depth) << 50) | (U64(age) << 58);
         return result;
     }
 
-    uint32_t decode_move(U64 x) {
-        return x & 0x0FFFFFFFF;
+    uint16_t decode_move(U64 x) {
+        return x & 0x0FFFF;
+    }
+
+    int16_t decode_eval(U64 x) {
+        return (x >> 16) & 0x0FFFF;
     }
 
     uint8_t decode_flag(U64 x) {
@@ -201,28 +408,51 @@ public:
     bool enabled;
 
     trans_table_t(int size_in_MB);
-    void set_size(int size_in_MB);
+    void set_size(int size_in_MB, pool_t * pool = NULL);
 
-    void store(U64 key, int age, int ply, int depth, int score, int move, int flag);
-    bool retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags);
+    void store(U64 key, int age, int ply, int depth, int score, int move, int flag, int eval, int thread_id);
+    bool retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags, int & eval, int thread_id);
 
     ~trans_table_t() {
-        delete [] table;
+        release();
     }
 
-    void clear() {
-        memset(table, 0, sizeof (entry_t) * size);
+    int clear_ms;
+
+    void clear(pool_t * pool = NULL);
+
+    void prefetch(U64 key) {
+        __builtin_prefetch(&table[index(key)]);
     }
+
+    U64 size_in_bytes() {
+        return sizeof (bucket_t) * size;
+    }
+
+    int page_size();
+
+    U64 huge_page_bytes();
+
+    void stats(hash_stats_t & total);
+
+    int hashfull(int age);
 };
 
 namespace trans_table {
     const int TABLE_SIZE = options::get_value("Hash");
-    void store(U64 key, int age, int ply, int depth, int score, int move, int flag);
-    bool retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags);
+    trans_table_t * instance();
+    void prefetch(U64 key);
+    void store(U64 key, int age, int ply, int depth, int score, int move, int flag, int eval, int thread_id);
+    bool retrieve(U64 key, int ply, int depth, int & score, int & move, int & flags, int & eval, int thread_id);
     void clear();
     void set_size(int size_in_MB);
+    void set_pool(pool_t * pool);
+    std::string info();
+    int clear_time();
     void enable();
     void disable();
+    void stats(hash_stats_t & total);
+    int hashfull(int age);
 };
 
 #endif	/* HASHTABLE_H */
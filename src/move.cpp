@@ -33,19 +33,37 @@ void move_t::set(move_t * move) {
 }
 
 /**
- * Copies / sets a move from move integer
- * @param move integer move
+ * Sets a move from a 16 bit move integer (see to_int). The piece and captured 
+ * piece are taken from the board, so this must be the position of the move.
+ * @param board the actual board position
+ * @param move integer move, 0 for no move
  */
-void move_t::set(int move) {
-    assert(move >= 0);
-    piece = move & 0x0F;
-    ssq = move >> 4 & 0x3F;
-    tsq = move >> 10 & 0x3F;
-    capture = move >> 16 & 0x0F;
-    promotion = move >> 20 & 0x0F;
-    castle = move >> 24 & 0x0F;
-    en_passant = (move & (0x01 << 28)) == (0x01 << 28);
+void move_t::set(board_t * board, int move) {
+    assert(move >= 0 && move <= 0xFFFF);
     score = score::INVALID;
+    if (move == 0) {
+        piece = 0;
+        return;
+    }
+    ssq = move & 0x3F;
+    tsq = move >> 6 & 0x3F;
+    piece = board->matrix[ssq];
+    capture = board->matrix[tsq];
+    promotion = 0;
+    castle = 0;
+    en_passant = false;
+    switch (move >> 14) {
+        case 1:
+            promotion = WKNIGHT + (move >> 12 & 3) + (piece == BPAWN ? WKING : 0);
+            break;
+        case 2:
+            en_passant = true;
+            capture = piece == WPAWN ? BPAWN : WPAWN;
+            break;
+        case 3:
+            castle = tsq == g1 ? CASTLE_K : tsq == c1 ? CASTLE_Q : tsq == g8 ? CASTLE_k : CASTLE_q;
+            break;
+    }
 }
 
 /**
@@ -62,6 +80,8 @@ void move_t::set(int pc, int from, int to, int captured_piece, int promotion_pie
     tsq = to;
     promotion = promotion_piece;
     capture = captured_piece;
+    castle = 0;
+    en_passant = false;
 }
 
 /**
@@ -143,20 +163,24 @@ std::string move_t::to_string() {
 }
 
 /**
- * Encodes and returns a move to a 32 bit integer
- * 0..3  | 4..9 | 10..5 | 16..19         | 20..23            | 24..27   | 28 | 
- * piece | from | to    | captured piece | promoted to piece | castling | ep | 
+ * Encodes and returns a move to a 16 bit integer
+ * 0..5 | 6..11 | 12..13                  | 14..15
+ * from | to    | promotion (n, b, r, q)  | promotion=1, ep=2, castling=3
  * 
- * @return integer representing move
+ * @return integer representing move, 0 for no move
  */
 int move_t::to_int() {
-    int result = piece;
-    result |= ssq << 4;
-    result |= tsq << 10;
-    result |= capture << 16;
-    result |= promotion << 20;
-    result |= castle << 24;
-    result |= en_passant << 28;
-    assert(result >= 0);
+    if (piece == 0) {
+        return 0;
+    }
+    int result = ssq | tsq << 6;
+    if (promotion) {
+        result |= ((promotion - WKNIGHT) % WKING) << 12 | 1 << 14;
+    } else if (en_passant) {
+        result |= 2 << 14;
+    } else if (castle) {
+        result |= 3 << 14;
+    }
+    assert(result > 0 && result <= 0xFFFF);
     return result;
 }
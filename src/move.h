@@ -40,7 +40,7 @@ public:
     int score;
 
     void set(move_t * move);
-    void set(int move);
+    void set(board_t * board, int move);
     void set(int pc, int from, int to, int captured_piece, int promotion_piece);
     void set(board_t * pos, const char * move_str);
     std::string to_string();
@@ -37,104 +37,308 @@ namespace move {
     void list_t::clear() {
         stage = 0;
         minimum_score = 0;
-        current = first = last = &_list[0];
-        best = &_list[MAX_MOVES];
+        current = first = last = 0;
+        deferred = 0;
+        masks_valid = false;
+    }
+
+    /*
+     * The generators are instantiated per side to move (template<bool US>), 
+     * so pieces, ranks and pawn shifts are compile-time constants.
+     */
+
+    template<bool US> inline U64 _up(const U64 x) {
+        return US ? UP1(x) : DOWN1(x);
+    }
+
+    template<bool US> inline U64 _up_left(const U64 x) {
+        return US ? UPLEFT1(x) : DOWNLEFT1(x);
+    }
+
+    template<bool US> inline U64 _up_right(const U64 x) {
+        return US ? UPRIGHT1(x) : DOWNRIGHT1(x);
     }
 
     /**
-     * Generate Captures. The captures are added to a movelist object.
+     * Test if a square is attacked, given an occupancy. Used for king moves,
+     * where our king must be removed from the occupancy first.
+     * @param board board structure object
+     * @param sq the square to investigate
+     * @param occ occupied squares
+     * @return true if the square is attacked by THEM
+     */
+    template<bool THEM> static inline bool _attacked(board_t * board, const int sq, const U64 occ) {
+        return board->bb[KNIGHT[THEM]] & KNIGHT_MOVES[sq]
+                || board->bb[PAWN[THEM]] & PAWN_CAPTURES[!THEM][sq]
+                || board->bb[KING[THEM]] & KING_MOVES[sq]
+                || (board->bb[ROOK[THEM]] | board->bb[QUEEN[THEM]]) & magic::rook_moves(sq, occ)
+                || (board->bb[BISHOP[THEM]] | board->bb[QUEEN[THEM]]) & magic::bishop_moves(sq, occ);
+    }
+
+    /**
+     * Calculates the pinned pieces, checkers and check mask once per node. 
+     * With these masks, the generators only produce legal moves and no 
+     * per-move legality test is needed. En-passant captures are the exception
+     * and are tested with board_t::legal.
      * @param board board structure object
      * @param list movelist object
-     * @param targets the pieces to capture
      */
-    void gen_captures(board_t * board, move::list_t * list) {
-        move_t * current = list->last;
-        list->current = current;
-        const bool us = board->us();
-        const bool them = !us;
+    template<bool US> static void _init_masks(board_t * board, list_t * list) {
+        if (list->masks_valid) {
+            return;
+        }
+        list->masks_valid = true;
+        list->pinned = 0;
+        list->checkers = 0;
+        list->check_mask = ~C64(0);
+        const bool THEM = !US;
+        const int kpos = board->get_sq(KING[US]);
         const U64 occ = board->bb[ALLPIECES];
-        const U64 targets = board->all(them);
-        U64 moves;
-        int ssq, tsq;
-        int pc = PAWN[us];
+        const U64 diag_sliders = board->bb[BISHOP[THEM]] | board->bb[QUEEN[THEM]];
+        const U64 hv_sliders = board->bb[ROOK[THEM]] | board->bb[QUEEN[THEM]];
 
-        //pawn captures (including en-passant and promotion captures):
-        U64 pawn_caps = targets;
-        if (board->stack->enpassant_sq) {
-            pawn_caps |= BIT(board->stack->enpassant_sq);
-        }
-        pawn_caps &= board->pawn_attacks(us);
-        while (pawn_caps) {
-            tsq = pop(pawn_caps);
-            moves = PAWN_CAPTURES[them][tsq] & board->bb[pc];
-            while (moves) {
-                ssq = pop(moves);
-                if (tsq == board->stack->enpassant_sq && tsq > 0) {
-                    (current++)->set(pc, ssq, tsq, PAWN[them]);
-                } else if ((BIT(tsq) & RANK[us][8]) == 0) {
-                    (current++)->set(pc, ssq, tsq, board->matrix[tsq]);
-                } else {
-                    (current++)->set(pc, ssq, tsq, board->matrix[tsq], QUEEN[us]);
-                    (current++)->set(pc, ssq, tsq, board->matrix[tsq], KNIGHT[us]);
-                    (current++)->set(pc, ssq, tsq, board->matrix[tsq], ROOK[us]);
-                    (current++)->set(pc, ssq, tsq, board->matrix[tsq], BISHOP[us]);
-                }
+        //sliders aiming at our king, with one piece in between (pin) or none (check)
+        U64 snipers = (BISHOP_MOVES[kpos] & diag_sliders) | (ROOK_MOVES[kpos] & hv_sliders);
+        while (snipers) {
+            int sq = pop(snipers);
+            U64 blockers = magic::between(kpos, sq) & occ;
+            if (blockers == 0) {
+                list->checkers |= BIT(sq);
+            } else if (is_1(blockers)) {
+                list->pinned |= blockers & board->all(US);
             }
         }
+        list->checkers |= (KNIGHT_MOVES[kpos] & board->bb[KNIGHT[THEM]])
+                | (PAWN_CAPTURES[US][kpos] & board->bb[PAWN[THEM]]);
 
-        //knight captures:
-        U64 pieces = board->bb[++pc];
-        while (pieces) {
-            ssq = pop(pieces);
-            moves = KNIGHT_MOVES[ssq] & targets;
-            while (moves) {
-                tsq = pop(moves);
-                (current++)->set(pc, ssq, tsq, board->matrix[tsq]);
-            }
+        //in check: capture the checker or block the check; double check: only king moves
+        if (list->checkers) {
+            list->check_mask = gt_1(list->checkers) ? 0
+                    : list->checkers | magic::between(kpos, bsf(list->checkers));
+        }
+    }
+
+    /**
+     * Target squares for a piece, considering pins and checks
+     * @param list movelist object with valid masks
+     * @param kpos our king square
+     * @param ssq source square of the piece
+     * @return bitboard with allowed target squares
+     */
+    static inline U64 _legal_targets(list_t * list, const int kpos, const int ssq) {
+        U64 result = list->check_mask;
+        if (list->pinned & BIT(ssq)) {
+            result &= magic::line(kpos, ssq);
         }
+        return result;
+    }
 
-        //bishop captures:
-        pieces = board->bb[++pc];
-        while (pieces) {
-            ssq = pop(pieces); //pp->squares[i];
-            moves = magic::bishop_moves(ssq, occ) & targets;
-            while (moves) {
-                tsq = pop(moves);
-                (current++)->set(pc, ssq, tsq, board->matrix[tsq]);
+    /**
+     * Adds the four promotion moves: queen, knight, rook and bishop
+     */
+    static inline uint16_t * _add_promotions(uint16_t * current, int ssq, int tsq) {
+        const int move = encode(ssq, tsq) | PROMOTION_FLAG;
+        *current++ = move | 3 << 12;
+        *current++ = move;
+        *current++ = move | 2 << 12;
+        *current++ = move | 1 << 12;
+        return current;
+    }
+
+    /**
+     * Adds pawn moves from a bitboard of target squares, all moved in the 
+     * same direction. Moves of pinned pawns must stay on the pin line.
+     * @param board board structure object
+     * @param list movelist object with valid masks
+     * @param current next free move in the list
+     * @param tsqs target squares
+     * @param dir distance from source square to target square
+     * @return next free move in the list
+     */
+    template<bool US> static inline uint16_t * _add_pawn_moves(board_t * board, list_t * list,
+            uint16_t * current, U64 tsqs, const int dir) {
+        const int kpos = board->get_sq(KING[US]);
+        while (tsqs) {
+            int tsq = pop(tsqs);
+            int ssq = tsq - dir;
+            if ((list->pinned & BIT(ssq)) && (magic::line(kpos, ssq) & BIT(tsq)) == 0) {
+                continue;
+            } else if (BIT(tsq) & RANK[US][8]) {
+                current = _add_promotions(current, ssq, tsq);
+            } else {
+                *current++ = encode(ssq, tsq);
             }
         }
+        return current;
+    }
 
-        //rook captures:
-        pieces = board->bb[++pc];
-        while (pieces) {
-            ssq = pop(pieces); //pp->squares[i];
-            moves = magic::rook_moves(ssq, occ) & targets;
-            while (moves) {
-                tsq = pop(moves);
-                (current++)->set(pc, ssq, tsq, board->matrix[tsq]);
+    /**
+     * Adds en-passant captures, tested with board_t::legal as the captured 
+     * pawn may expose our king on the rank
+     */
+    template<bool US> static inline uint16_t * _add_en_passant(board_t * board, uint16_t * current) {
+        const int ep_sq = board->stack->enpassant_sq;
+        if (ep_sq) {
+            U64 pawns = PAWN_CAPTURES[!US][ep_sq] & board->bb[PAWN[US]];
+            while (pawns) {
+                move_t move;
+                move.set(PAWN[US], pop(pawns), ep_sq, PAWN[!US]);
+                move.en_passant = true;
+                if (board->legal(&move)) {
+                    *current++ = encode(move.ssq, ep_sq) | EN_PASSANT_FLAG;
+                }
             }
         }
+        return current;
+    }
 
-        //queen captures:
-        pieces = board->bb[++pc];
+    /**
+     * Adds the moves of one piece type to a set of target squares
+     */
+    template<int PC> static inline uint16_t * _add_piece_moves(board_t * board, list_t * list,
+            uint16_t * current, const U64 targets, const int kpos) {
+        const U64 occ = board->bb[ALLPIECES];
+        U64 pieces = board->bb[PC];
+        if (PC == WKNIGHT || PC == BKNIGHT) {
+            pieces &= ~list->pinned; //a pinned knight can never move
+        }
         while (pieces) {
-            ssq = pop(pieces); //pp->squares[i];
-            moves = magic::queen_moves(ssq, occ) & targets;
+            int ssq = pop(pieces);
+            U64 moves;
+            if (PC == WKNIGHT || PC == BKNIGHT) {
+                moves = KNIGHT_MOVES[ssq] & targets;
+            } else if (PC == WBISHOP || PC == BBISHOP) {
+                moves = magic::bishop_moves(ssq, occ) & targets & _legal_targets(list, kpos, ssq);
+            } else if (PC == WROOK || PC == BROOK) {
+                moves = magic::rook_moves(ssq, occ) & targets & _legal_targets(list, kpos, ssq);
+            } else {
+                moves = magic::queen_moves(ssq, occ) & targets & _legal_targets(list, kpos, ssq);
+            }
             while (moves) {
-                tsq = pop(moves);
-                (current++)->set(pc, ssq, tsq, board->matrix[tsq]);
+                *current++ = encode(ssq, pop(moves));
             }
         }
+        return current;
+    }
 
-        //king captures:
-        int kpos = board->get_sq(++pc);
-        moves = KING_MOVES[kpos] & targets;
+    /**
+     * Adds king moves to safe squares
+     */
+    template<bool US> static inline uint16_t * _add_king_moves(board_t * board, uint16_t * current, const U64 targets) {
+        const int kpos = board->get_sq(KING[US]);
+        const U64 occ = board->bb[ALLPIECES] ^ BIT(kpos);
+        U64 moves = KING_MOVES[kpos] & targets;
         while (moves) {
-            tsq = pop(moves);
-            (current++)->set(pc, kpos, tsq, board->matrix[tsq]);
+            int tsq = pop(moves);
+            if (!_attacked<!US>(board, tsq, occ)) {
+                *current++ = encode(kpos, tsq);
+            }
         }
+        return current;
+    }
+
+    template<bool US> static void _gen_captures(board_t * board, list_t * list) {
+        _init_masks<US>(board, list);
+        uint16_t * current = &list->moves[list->last];
+        list->current = list->last;
+        const U64 targets = board->all(!US) & list->check_mask;
+        const int kpos = board->get_sq(KING[US]);
+        const U64 pawns = board->bb[PAWN[US]];
+
+        //pawn captures (including en-passant and promotion captures):
+        current = _add_pawn_moves<US>(board, list, current, _up_left<US>(pawns) & targets, US ? 7 : -9);
+        current = _add_pawn_moves<US>(board, list, current, _up_right<US>(pawns) & targets, US ? 9 : -7);
+        current = _add_en_passant<US>(board, current);
+
+        //piece captures:
+        current = _add_piece_moves<US ? WKNIGHT : BKNIGHT>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WBISHOP : BBISHOP>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WROOK : BROOK>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WQUEEN : BQUEEN>(board, list, current, targets, kpos);
 
-        list->last = current;
+        //king captures, the king may not capture a defended piece:
+        current = _add_king_moves<US>(board, current, board->all(!US));
+
+        list->last = current - list->moves;
+    }
+
+    template<bool US> static void _gen_promotions(board_t * board, list_t * list) {
+        _init_masks<US>(board, list);
+        uint16_t * current = &list->moves[list->last];
+        list->current = list->last;
+        U64 tsqs = _up<US>(board->bb[PAWN[US]] & RANK[US][7]) & ~board->bb[ALLPIECES] & list->check_mask;
+        current = _add_pawn_moves<US>(board, list, current, tsqs, PAWN_DIRECTION[US]);
+        list->last = current - list->moves;
+    }
+
+    template<bool US> static void _gen_quiet_moves(board_t * board, list_t * list) {
+        _init_masks<US>(board, list);
+        uint16_t * current = &list->moves[list->last];
+        list->current = list->last;
+        const U64 empty = ~board->bb[ALLPIECES];
+        const U64 targets = empty & list->check_mask;
+        const int kpos = board->get_sq(KING[US]);
+
+        //pawn moves, single and double pushes:
+        U64 single = _up<US>(board->bb[PAWN[US]] & ~RANK[US][7]) & empty;
+        U64 double_push = _up<US>(single & RANK[US][3]) & targets;
+        current = _add_pawn_moves<US>(board, list, current, single & targets, PAWN_DIRECTION[US]);
+        current = _add_pawn_moves<US>(board, list, current, double_push, 2 * PAWN_DIRECTION[US]);
+
+        //piece moves:
+        current = _add_piece_moves<US ? WKNIGHT : BKNIGHT>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WBISHOP : BBISHOP>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WROOK : BROOK>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WQUEEN : BQUEEN>(board, list, current, targets, kpos);
+
+        //king moves:
+        current = _add_king_moves<US>(board, current, empty);
+
+        list->last = current - list->moves;
+    }
+
+    template<bool US> static void _gen_evasions(board_t * board, list_t * list) {
+        _init_masks<US>(board, list);
+        uint16_t * current = &list->moves[list->last];
+        list->current = list->last;
+        const U64 occ = board->bb[ALLPIECES];
+        const int kpos = board->get_sq(KING[US]);
+
+        //king moves, including captures:
+        current = _add_king_moves<US>(board, current, ~board->all(US));
+        if (gt_1(list->checkers)) {
+            list->last = current - list->moves;
+            return;
+        }
+
+        //capture the checker or move a piece in between, pinned pieces can't help:
+        const U64 targets = list->check_mask;
+        const U64 pawns = board->bb[PAWN[US]] & ~list->pinned;
+        const U64 single = _up<US>(pawns) & ~occ;
+        current = _add_pawn_moves<US>(board, list, current, _up_left<US>(pawns) & list->checkers, US ? 7 : -9);
+        current = _add_pawn_moves<US>(board, list, current, _up_right<US>(pawns) & list->checkers, US ? 9 : -7);
+        current = _add_en_passant<US>(board, current);
+        current = _add_pawn_moves<US>(board, list, current, single & targets, PAWN_DIRECTION[US]);
+        current = _add_pawn_moves<US>(board, list, current,
+                _up<US>(single & RANK[US][3]) & ~occ & targets, 2 * PAWN_DIRECTION[US]);
+        current = _add_piece_moves<US ? WKNIGHT : BKNIGHT>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WBISHOP : BBISHOP>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WROOK : BROOK>(board, list, current, targets, kpos);
+        current = _add_piece_moves<US ? WQUEEN : BQUEEN>(board, list, current, targets, kpos);
+        list->last = current - list->moves;
+    }
+
+    /**
+     * Generate Captures. The captures are added to a movelist object.
+     * @param board board structure object
+     * @param list movelist object
+     */
+    void gen_captures(board_t * board, move::list_t * list) {
+        if (board->us()) {
+            _gen_captures<WHITE>(board, list);
+        } else {
+            _gen_captures<BLACK>(board, list);
+        }
     }
 
     /**
@@ -143,22 +347,11 @@ namespace move {
      * @param list movelist object
      */
     void gen_promotions(board_t * board, move::list_t * list) {
-        move_t * current = list->last;
-        list->current = current;
-        const bool us = board->us();
-        const int pc = PAWN[us];
-        U64 pieces = board->bb[pc] & RANK[us][7];
-        while (pieces) {
-            int ssq = pop(pieces);
-            int tsq = ssq + PAWN_DIRECTION[us];
-            if (board->matrix[tsq] == EMPTY) {
-                (current++)->set(pc, ssq, tsq, 0, QUEEN[us]);
-                (current++)->set(pc, ssq, tsq, 0, KNIGHT[us]);
-                (current++)->set(pc, ssq, tsq, 0, ROOK[us]);
-                (current++)->set(pc, ssq, tsq, 0, BISHOP[us]);
-            }
+        if (board->us()) {
+            _gen_promotions<WHITE>(board, list);
+        } else {
+            _gen_promotions<BLACK>(board, list);
         }
-        list->last = current;
     }
 
     /**
@@ -168,36 +361,45 @@ namespace move {
      * @param list movelist object
      */
     void gen_castles(board_t * board, move::list_t * list) {
-        move_t * current = list->last;
-        list->current = current;
-        if (board->has_castle_right(CASTLE_ANY)) {
+        if (board->us()) {
+            _init_masks<WHITE>(board, list);
+        } else {
+            _init_masks<BLACK>(board, list);
+        }
+        uint16_t * current = &list->moves[list->last];
+        list->current = list->last;
+        if (board->has_castle_right(CASTLE_ANY) && list->checkers == 0) {
             if (board->us()) {
                 if (board->has_castle_right(CASTLE_K)
                         && board->matrix[f1] == EMPTY
-                        && board->matrix[g1] == EMPTY) {
-                    (current++)->set(WKING, e1, g1);
+                        && board->matrix[g1] == EMPTY
+                        && !board->is_attacked(f1, BLACK) && !board->is_attacked(g1, BLACK)) {
+                    *current++ = encode(e1, g1) | CASTLE_FLAG;
                 }
                 if (board->has_castle_right(CASTLE_Q)
                         && board->matrix[d1] == EMPTY
                         && board->matrix[c1] == EMPTY
-                        && board->matrix[b1] == EMPTY) {
-                    (current++)->set(WKING, e1, c1);
+                        && board->matrix[b1] == EMPTY
+                        && !board->is_attacked(d1, BLACK) && !board->is_attacked(c1, BLACK)) {
+                    *current++ = encode(e1, c1) | CASTLE_FLAG;
                 }
             } else {
                 if (board->has_castle_right(CASTLE_k)
                         && board->matrix[f8] == EMPTY
-                        && board->matrix[g8] == EMPTY) {
-                    (current++)->set(BKING, e8, g8);
+                        && board->matrix[g8] == EMPTY
+                        && !board->is_attacked(f8, WHITE) && !board->is_attacked(g8, WHITE)) {
+                    *current++ = encode(e8, g8) | CASTLE_FLAG;
                 }
                 if (board->has_castle_right(CASTLE_q)
                         && board->matrix[d8] == EMPTY
                         && board->matrix[c8] == EMPTY
-                        && board->matrix[b8] == EMPTY) {
-                    (current++)->set(BKING, e8, c8);
+                        && board->matrix[b8] == EMPTY
+                        && !board->is_attacked(d8, WHITE) && !board->is_attacked(c8, WHITE)) {
+                    *current++ = encode(e8, c8) | CASTLE_FLAG;
                 }
             }
         }
-        list->last = current;
+        list->last = current - list->moves;
     }
 
     /**
@@ -207,81 +409,39 @@ namespace move {
      * @param list movelist object
      */
     void gen_quiet_moves(board_t * board, move::list_t * list) {
-        move_t * current = list->last;
-        list->current = current;
-        U64 moves;
-        const U64 occ = board->bb[ALLPIECES];
-        const U64 targets = ~occ;
-        const bool us = board->us();
-        const int pawn_up = PAWN_DIRECTION[us];
-        int pc = PAWN[us];
-        int ssq;
-
-        //pawn moves:
-        U64 pieces = board->bb[pc] & ~RANK[us][7];
-        while (pieces) {
-            ssq = pop(pieces);
-            int tsq = ssq + pawn_up;
-            if (board->matrix[tsq] != EMPTY) {
-                continue;
-            }
-            (current++)->set(pc, ssq, tsq);
-            if (BIT(ssq) & RANK[us][2]) {
-                tsq += pawn_up;
-                if (board->matrix[tsq] == EMPTY) {
-                    (current++)->set(pc, ssq, tsq);
-                }
-            }
-        }
-
-        //knight moves:
-        pieces = board->bb[++pc];
-        while (pieces) {
-            ssq = pop(pieces);
-            moves = KNIGHT_MOVES[ssq] & targets;
-            while (moves) {
-                (current++)->set(pc, ssq, pop(moves));
-            }
-        }
-
-        //bishop moves:
-        pieces = board->bb[++pc];
-        while (pieces) {
-            ssq = pop(pieces);
-            moves = magic::bishop_moves(ssq, occ) & targets;
-            while (moves) {
-                (current++)->set(pc, ssq, pop(moves));
-            }
-        }
-
-        //rook moves:
-        pieces = board->bb[++pc];
-        while (pieces) {
-            ssq = pop(pieces);
-            moves = magic::rook_moves(ssq, occ) & targets;
-            while (moves) {
-                (current++)->set(pc, ssq, pop(moves));
-            }
+        if (board->us()) {
+            _gen_quiet_moves<WHITE>(board, list);
+        } else {
+            _gen_quiet_moves<BLACK>(board, list);
         }
+    }
 
-        //queen moves:
-        pieces = board->bb[++pc];
-        while (pieces) {
-            ssq = pop(pieces);
-            moves = magic::queen_moves(ssq, occ) & targets;
-            while (moves) {
-                (current++)->set(pc, ssq, pop(moves));
-            }
+    /**
+     * Generate check evasions: king moves, capturing the checker and blocking
+     * the check. Pinned pieces can never resolve a check and in double check 
+     * only king moves are generated. All evasions are added to the movelist in
+     * one go. If not in check, all legal moves are generated.
+     * @param board board structure object
+     * @param list movelist object
+     */
+    void gen_evasions(board_t * board, move::list_t * list) {
+        if (board->us()) {
+            _init_masks<WHITE>(board, list);
+        } else {
+            _init_masks<BLACK>(board, list);
         }
-
-        //king moves:
-        int kpos = board->get_sq(++pc);
-        moves = KING_MOVES[kpos] & targets;
-        while (moves) {
-            (current++)->set(pc, kpos, pop(moves));
+        const int start = list->last;
+        if (list->checkers == 0) {
+            gen_captures(board, list);
+            gen_promotions(board, list);
+            gen_castles(board, list);
+            gen_quiet_moves(board, list);
+            list->current = start;
+        } else if (board->us()) {
+            _gen_evasions<WHITE>(board, list);
+        } else {
+            _gen_evasions<BLACK>(board, list);
         }
-
-        list->last = current;
     }
 
     U64 get_moves_bb(board_t * brd, int pc, int sq) {
@@ -34,25 +34,77 @@ namespace move {
     const int ILLEGAL = -32002;
     const int INF = 32000;
     const int LEGAL = 31000;
+    const int EVASION_CAPTURE = 10000; //above the quiet move history scores
 
+    /**
+     * Flags of the 16 bit move encoding, see move_t::to_int
+     */
+    const int PROMOTION_FLAG = 1 << 14;
+    const int EN_PASSANT_FLAG = 2 << 14;
+    const int CASTLE_FLAG = 3 << 14;
+
+    /**
+     * Encodes a move without flags to a 16 bit integer
+     * @param ssq source square
+     * @param tsq target square
+     * @return integer move
+     */
+    inline uint16_t encode(int ssq, int tsq) {
+        return ssq | tsq << 6;
+    }
+
+    /**
+     * Move list. Moves are stored as 16 bit integers, with their sort scores 
+     * in a separate array, and decoded into a move_t when they are picked.
+     * The positions in the list are indices into both arrays.
+     */
     class list_t {
     public:
-        move_t _list[MAX_MOVES + 1];
+        uint16_t moves[MAX_MOVES + 1];
+        int scores[MAX_MOVES + 1];
         int stage;
         int minimum_score;
-        move_t * current;
-        move_t * first;
-        move_t * last;
-        move_t * best;
+        int current;
+        int first;
+        int last;
+        int deferred; //end of the captures with see < 0, stored from the start of the list
+        move_t move; //the last move picked from the list
+        U64 pinned; //our pieces pinned to our king
+        U64 checkers; //their pieces giving check
+        U64 check_mask; //target squares for non-king moves, all squares if not in check
+        bool masks_valid; //pinned, checkers and check_mask are calculated for this node
 
         list_t();
         void clear();
+
+        /**
+         * Adds a move at the end of the list
+         * @param move integer move
+         * @param score sort score
+         */
+        void push(int move, int score) {
+            assert(last <= MAX_MOVES);
+            moves[last] = move;
+            scores[last++] = score;
+        }
+
+        /**
+         * Decodes a move of the list
+         * @param board the position of the list
+         * @param ix index of the move
+         * @param result the decoded move
+         */
+        void get(board_t * board, int ix, move_t * result) {
+            result->set(board, moves[ix]);
+            result->score = scores[ix];
+        }
     };
 
     void gen_quiet_moves(board_t * board, list_t * list);
     void gen_promotions(board_t * board, list_t * list);
     void gen_castles(board_t * board, list_t * list);
     void gen_captures(board_t * board, list_t * list);
+    void gen_evasions(board_t * board, list_t * list);
     
     U64 get_moves_bb(board_t * board, int pc, int sq);
 }
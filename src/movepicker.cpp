@@ -22,6 +22,8 @@
  * - Killer Moves
  * - Captures
  * - Quiet Moves
+ * When in check, all moves after the killer moves are generated at once as
+ * check evasions.
  * All moves returned are legal. If the move picker does not return any move, 
  * it's a (stale)mate.
  */
@@ -31,55 +33,71 @@
 #include <algorithm> 
 
 /**
- * Pops the move with highest score above a minimum from the move list
+ * Pops the next move with a score above a minimum from the move list. The
+ * moves are sorted when a stage is generated, so this is the first move.
+ * Captures losing material are not tried yet, but deferred to the start of 
+ * the list, where they are picked up in the minor promotions stage.
  * @param s search object
  * @param list move list
- * @return best move on the list or null
+ * @return best move on the list, decoded in list->move, or null
  */
 move_t * move_picker_t::pop(search_t * s, move::list_t * list) {
     while (list->first != list->last) {
-
-        //pick move with the highest score
-
-        move_t * best = list->first;
-        for (move_t * move = list->first + 1; move != list->last; move++) {
-            if (*move > *best) {
-                best = move;
-            }
-        }
+        const int ix = list->first;
 
         //return if move score is too low
-        if (best->score < list->minimum_score) {
+        if (list->scores[ix] < list->minimum_score) {
             return NULL;
         }
+        list->first++;
+        move_t * result = &list->move;
+        list->get(&s->brd, ix, result);
 
-        //filter negative see if still in "good captures" phase
-        if (list->minimum_score == 0 && best->capture) {
-            const int see = s->brd.see(best);
+        //lazy see: defer captures losing material if still in "good captures" phase
+        if (list->minimum_score == 0 && result->capture) {
+            const int see = s->brd.see(result);
             if (see < 0) {
-                best->score = see;
+                list->moves[list->deferred] = list->moves[ix];
+                list->scores[list->deferred++] = see;
                 continue;
             }
         }
 
-        //legality check just before returning the move
-        move_t * result = list->best;
-        if (result != best) {
-            result->set(best);
-        }
-        if (best != --list->last) {
-            best->set(list->last);
-        }
-        if (!s->stack->tt_move.equals(result)
-                && !s->is_killer(result)
-                && s->brd.legal(result)) {
+        //the generators only produce legal moves, skip the hash move and killers
+        if (!s->stack->tt_move.equals(result) && !s->is_killer(result)) {
             return result;
         }
-
     };
     return NULL;
 }
 
+/**
+ * Partial insertion sort on descending score. Moves scoring at least the limit
+ * are sorted to the front, the others are left behind unsorted.
+ * @param list move list
+ * @param begin index of the first move
+ * @param end end of the moves
+ * @param limit minimum score of the sorted moves
+ */
+void move_picker_t::sort(move::list_t * list, int begin, int end, int limit) {
+    int sorted_end = begin;
+    for (int i = begin; i != end; i++) {
+        if (list->scores[i] >= limit) {
+            const uint16_t move = list->moves[i];
+            const int score = list->scores[i];
+            list->moves[i] = list->moves[sorted_end];
+            list->scores[i] = list->scores[sorted_end];
+            int insert = sorted_end++;
+            for (; insert != begin && list->scores[insert - 1] < score; insert--) {
+                list->moves[insert] = list->moves[insert - 1];
+                list->scores[insert] = list->scores[insert - 1];
+            }
+            list->moves[insert] = move;
+            list->scores[insert] = score;
+        }
+    }
+}
+
 /**
  * Gets the first move from the list, by clearing the search list and calling
  * "next"
@@ -104,8 +122,8 @@ move_t * move_picker_t::first(search_t * s, int depth) {
 move_t * move_picker_t::next(search_t * s, int depth) {
 
     /*
-     * 1. Pop the best move from the list. If a move is found, a just-in-time 
-     * legality check is done and the movepicker returns a valid, legal, move.
+     * 1. Pop the best move from the list. If a move is found, the movepicker
+     * returns a valid, legal, move.
      */
     move::list_t * list = &s->stack->move_list;
     move_t * result = pop(s, list);
@@ -118,7 +136,9 @@ move_t * move_picker_t::next(search_t * s, int depth) {
      * (some) moves.
      */
     board_t * brd = &s->brd;
+    move_t move;
     const bool do_quiets = depth >= 0 || s->stack->in_check;
+    const bool do_evasions = s->stack->in_check && s->wild != 17;
     switch (list->stage) {
         case HASH:
             result = &s->stack->tt_move;
@@ -129,15 +149,19 @@ move_t * move_picker_t::next(search_t * s, int depth) {
                 return result;
             }
         case CAPTURES:
-            move::gen_captures(brd, list);
+            if (!do_evasions) {
+                move::gen_captures(brd, list);
+            }
             if (list->current != list->last) {
-                for (move_t * move = list->current; move != list->last; move++) {
+                for (int i = list->current; i != list->last; i++) {
+                    list->get(brd, i, &move);
                     if (s->wild == 17) {
-                        move->score = s->brd.is_attacked(move->tsq, move->capture <= WKING);
+                        list->scores[i] = s->brd.is_attacked(move.tsq, move.capture <= WKING);
                     } else {
-                        move->score = brd->mvvlva(move);
+                        list->scores[i] = brd->mvvlva(&move);
                     }
                 }
+                sort(list, list->current, list->last, -move::INF);
                 if (s->wild != 17) {
                     result = pop(s, list);
                     if (result) {
@@ -154,17 +178,21 @@ move_t * move_picker_t::next(search_t * s, int depth) {
                 }
             }
         case PROMOTIONS:
-            move::gen_promotions(brd, list);
+            if (!do_evasions) {
+                move::gen_promotions(brd, list);
+            }
             if (list->current != list->last) {
-                for (move_t * move = list->current; move != list->last; move++) {
+                for (int i = list->current; i != list->last; i++) {
+                    list->get(brd, i, &move);
                     if (s->wild == 17) {
-                        move->score = 10 - move->promotion;
-                    } else if (depth <= 0 || brd->see(move) >= 0) {
-                        move->score = move->promotion;
+                        list->scores[i] = 10 - move.promotion;
+                    } else if (depth <= 0 || brd->see(&move) >= 0) {
+                        list->scores[i] = move.promotion;
                     } else {
-                        move->score = -100 + move->promotion;
+                        list->scores[i] = -100 + move.promotion;
                     }
                 }
+                sort(list, list->current, list->last, -move::INF);
                 result = pop(s, list);
                 if (result) {
                     list->stage = KILLER1;
@@ -192,12 +220,36 @@ move_t * move_picker_t::next(search_t * s, int depth) {
                         && brd->legal(result)) {
                     assert(s->stack->killer[0].equals(result) == false);
                     assert(result->capture == EMPTY && result->promotion == EMPTY);
-                    list->stage = MINORPROMOTIONS;
+                    list->stage = EVASIONS;
                     return result;
                 }
             }
+        case EVASIONS: //in check: all remaining moves are generated in one go
+            if (do_evasions) {
+                list->minimum_score = -move::INF;
+                move::gen_evasions(brd, list);
+                for (int i = list->current; i != list->last; i++) {
+                    list->get(brd, i, &move);
+                    if (move.capture || move.promotion) {
+                        list->scores[i] = move::EVASION_CAPTURE + brd->mvvlva(&move);
+                    } else {
+                        list->scores[i] = s->history[move.piece][move.tsq];
+                    }
+                }
+                sort(list, list->current, list->last, -move::INF);
+                list->stage = STOP;
+                result = pop(s, list);
+                return result;
+            }
         case MINORPROMOTIONS: //and captures with see < 0
             list->minimum_score = -move::INF;
+            for (int i = list->first; i != list->last; i++) {
+                list->moves[list->deferred] = list->moves[i];
+                list->scores[list->deferred++] = list->scores[i];
+            }
+            list->first = list->current = 0;
+            list->last = list->deferred;
+            sort(list, list->first, list->last, -move::INF);
             result = pop(s, list);
             if (result) {
                 list->stage = CASTLING;
@@ -206,8 +258,8 @@ move_t * move_picker_t::next(search_t * s, int depth) {
         case CASTLING:
             if (s->stack->in_check == false) {
                 move::gen_castles(brd, list);
-                for (move_t * move = list->current; move != list->last; move++) {
-                    move->score = 100;
+                for (int i = list->current; i != list->last; i++) {
+                    list->scores[i] = 100;
                 }
                 result = pop(s, list);
                 if (result) {
@@ -219,9 +271,11 @@ move_t * move_picker_t::next(search_t * s, int depth) {
             if (do_quiets) {
                 list->minimum_score = -move::INF;
                 move::gen_quiet_moves(brd, list);
-                for (move_t * move = list->current; move != list->last; move++) {
-                    move->score = s->history[move->piece][move->tsq];
+                for (int i = list->current; i != list->last; i++) {
+                    const int tsq = list->moves[i] >> 6 & 63;
+                    list->scores[i] = s->history[brd->matrix[list->moves[i] & 63]][tsq];
                 }
+                sort(list, list->current, list->last, 1); //moves without history keep the generation order
                 list->stage = STOP;
                 result = pop(s, list);
                 return result;
@@ -38,6 +38,7 @@ enum move_stage_t {
     PROMOTIONS,
     KILLER1,
     KILLER2,
+    EVASIONS,
     MINORPROMOTIONS,
     CASTLING,
     QUIET_MOVES,
@@ -47,6 +48,7 @@ enum move_stage_t {
 class move_picker_t {
 private:
     move_t * pop(search_t * s, move::list_t * list);
+    void sort(move::list_t * list, int begin, int end, int limit);
 
 public:
     move_t * first(search_t * s, int depth);
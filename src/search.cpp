@@ -76,23 +76,38 @@ void search_t::init(const char * fen, game_t * g) {
     book_name = "book.bin";
     king_attack_shelter = options::get_value("KingAttackShelter");
     king_attack_pieces = options::get_value("KingAttackPieces");
+    piece_activity = options::get_value("PieceActivity");
+    passed_pawns = options::get_value("PassedPawns");
     beta_pruning = options::get_value("BetaPruning");
     null_verify = options::get_value("NullVerify");
     null_enabled = options::get_value("NullMove");
     lmr_enabled = options::get_value("LMR");
     ffp_enabled = options::get_value("FutilityPruning");
     draw_contempt = options::get_value("DrawContempt");
+    multi_pv = range(1, MAX_MULTI_PV, options::get_value("MultiPV"));
     ponder_move.clear();
     nodes = 0;
     pruned_nodes = 0;
+    evals = 0;
+    tt_evals = 0;
+    cached_evals = 0;
     stop_all = false;
     next_poll = 0;
+    poll_interval = 0;
+    last_poll = time_man::now();
     sel_depth = 0;
     root_stack = stack = &_stack[0];
     root_wtm = brd.stack->wtm;
     result_score = 0;
+    result_depth = 0;
+    set_thread(0);
+    ttable = trans_table::instance();
+    ecache = eval_cache::instance();
     memset(_stack, 0, sizeof (_stack));
     memset(history, 0, sizeof (history));
+    for (int i = 0; i < 100; i++) {
+        rep_keys[i] = rep_table::retrieve(i);
+    }
     stack->eval_result = score::INVALID;
 }
 
@@ -101,37 +116,39 @@ void search_t::init(const char * fen, game_t * g) {
  */
 bool search_t::book_lookup() {
     bool result = false;
-    book::open(book_name);
+    book_t * book = book::get(book_name);
+    if (book == NULL) {
+        return false;
+    }
     move::list_t * bmoves = &stack->move_list;
-    int total_score = book::find(&brd, bmoves);
+    int total_score = book->find(&brd, bmoves);
     if (total_score > 0) {
         int rnd = (rand() % total_score) + 1;
         int score = 0;
-        for (move_t * bmove = bmoves->first; bmove != bmoves->last; bmove++) {
-            score += bmove->score;
+        for (int i = bmoves->first; i != bmoves->last; i++) {
+            score += bmoves->scores[i];
             if (score >= rnd) {
                 result = true;
-                stack->best_move.set(bmove);
+                bmoves->get(&brd, i, &stack->best_move);
                 break;
             }
         }
     }
-    book::close();
     return result;
 }
 
 /**
- * Starts the searching
+ * Starts the searching. The best move is sent by the engine, after the
+ * results of all search threads are collected.
  */
 void search_t::go() {
     assert(stack->best_move.piece == 0 && ponder_move.piece == 0);
-    if (book_lookup()) { //book hit
-        uci::send_pv(0, 1, 1, 1, game->tm.elapsed(),
+    if (options::get_value("OwnBook") && book_lookup()) { //book hit
+        uci::send_pv(0, 1, 1, 1, game->tm.elapsed(), 0,
                 stack->best_move.to_string().c_str(), score::EXACT);
     } else if (init_root_moves() > 0) { //do id search
         iterative_deepening();
     }
-    uci::send_bestmove(stack->best_move, ponder_move);
 }
 
 /**
@@ -159,22 +176,76 @@ void search_t::book_calc() {
 }
 
 
+/**
+ * Lazy SMP depth staggering: helper threads skip some of the iterations, so
+ * that not all threads search the same depth at the same time
+ * @param depth the iteration depth
+ * @return true if the iteration should be skipped
+ */
+bool search_t::skip_depth(int depth) {
+    static const int PATTERNS = 20;
+    static const int SKIP_SIZE[PATTERNS] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+    static const int SKIP_PHASE[PATTERNS] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+    if (thread_id == 0 || depth <= 1) {
+        return false;
+    }
+    const int ix = (thread_id - 1) % PATTERNS;
+    return ((depth + SKIP_PHASE[ix]) / SKIP_SIZE[ix]) % 2;
+}
+
+/**
+ * Binds the search to a thread index and to that thread's pawn and material tables
+ * @param id thread index, 0 for the main search thread
+ */
+void search_t::set_thread(int id) {
+    thread_id = id;
+    ptable = pawn_table::instance(id);
+    mtable = material_table::instance(id);
+}
+
+/**
+ * Tunable integer parameter, initialized from the option with the same name
+ * @param name option name
+ * @return pointer to the parameter or NULL if the parameter is not tunable
+ */
+int * search_t::param(const std::string & name) {
+    if (name == "KingAttackShelter") {
+        return &king_attack_shelter;
+    } else if (name == "KingAttackPieces") {
+        return &king_attack_pieces;
+    } else if (name == "PieceActivity") {
+        return &piece_activity;
+    } else if (name == "PassedPawns") {
+        return &passed_pawns;
+    } else if (name == "DrawContempt") {
+        return &draw_contempt;
+    }
+    return NULL;
+}
+
 /**
  * Iterative deepening - call aspiration search iterating over the depth. 
  * For timed searched, the function decides if a new iteration should be started 
- * or not.
+ * or not. Helper threads (thread_id > 0) search silently until they are stopped.
  */
 void search_t::iterative_deepening() {
     int last_score = -score::INF;
     const int max_time = game->tm.reserved_max();
     const int min_time = game->tm.reserved_min();
-    bool timed_search = game->white_time || game->black_time;
+    bool timed_search = thread_id == 0 && (game->white_time || game->black_time);
     int depth;
     for (depth = 1; depth <= game->max_depth; depth++) {
+        if (skip_depth(depth)) {
+            continue;
+        }
         int score = aspiration(depth, last_score);
         if (abort(true)) {
             break;
         }
+        result_depth = depth;
+        if (multi_pv > 1 && thread_id == 0) {
+            multi_pv_search(depth);
+        }
         store_pv();
         if (timed_search) {
             bool score_jump = depth >= 6 && ((ABS(score - last_score) > 20) || score > score::WIN);
@@ -209,10 +280,18 @@ void search_t::iterative_deepening() {
         last_score = score;
     }
     if (stack->pv_count > 0) {
-        uci::send_pv(result_score, MIN(depth, game->max_depth), sel_depth,
-                nodes + pruned_nodes, game->tm.elapsed(), pv_to_string().c_str(), score::EXACT);
+        if (thread_id == 0 && multi_pv > 1) {
+            send_multi_pv();
+        } else if (thread_id == 0) {
+            uci::send_pv(result_score, MIN(depth, game->max_depth), sel_depth,
+                    total_nodes(), game->tm.elapsed(), ttable->hashfull(brd.root_ply), pv_to_string().c_str(), score::EXACT);
+        }
         if (stack->pv_count > 1) {
-            ponder_move.set(&stack->pv_moves[1]);
+            move_t first_move;
+            first_move.set(&brd, stack->pv_moves[0]);
+            brd.forward(&first_move);
+            ponder_move.set(&brd, stack->pv_moves[1]);
+            brd.backward(&first_move);
         }
     }
 }
@@ -244,20 +323,95 @@ int search_t::aspiration(int depth, int last_score) {
 }
 
 /**
- * Poll to test is the search should be aborted
+ * Multi-PV: after the best line is found, the next best lines are searched 
+ * one by one in the same iteration. Each search excludes the moves of the 
+ * better lines, which are kept in front of the root move list. Afterwards 
+ * the best line is restored, so the rest of the search only sees line 1.
+ * @param depth iteration depth
+ */
+void search_t::multi_pv_search(int depth) {
+    const int count = MIN(multi_pv, root.move_count);
+    pv_line_t * best_line = &root.lines[0];
+    memcpy(best_line->pv_moves, stack->pv_moves, stack->pv_count * sizeof (uint16_t));
+    best_line->pv_count = stack->pv_count;
+    best_line->score = result_score;
+    best_line->depth = depth;
+    move_t pv_move;
+    int pv_index;
+    for (pv_index = 1; pv_index < count; pv_index++) {
+        root.pv_index = pv_index - 1;
+        pv_move.set(&brd, stack->pv_moves[0]);
+        root.sort_moves(&pv_move); //previous line first
+        root.pv_index = pv_index;
+        pv_line_t * line = &root.lines[pv_index];
+        int last_score = line->depth > 0 ? line->score : -score::INF;
+        if (line->depth > 0) {
+            stack->best_move.set(&brd, line->pv_moves[0]);
+        } else {
+            stack->best_move.set(&root.moves[pv_index].move);
+        }
+        stack->pv_count = 0;
+        int score = aspiration(depth, last_score);
+        if (abort(true)) {
+            break;
+        }
+        memcpy(line->pv_moves, stack->pv_moves, stack->pv_count * sizeof (uint16_t));
+        line->pv_count = stack->pv_count;
+        line->score = score;
+        line->depth = depth;
+    }
+    if (pv_index == count) {
+        send_multi_pv();
+    }
+    root.pv_index = 0;
+    pv_move.set(&brd, best_line->pv_moves[0]);
+    root.sort_moves(&pv_move);
+    memcpy(stack->pv_moves, best_line->pv_moves, best_line->pv_count * sizeof (uint16_t));
+    stack->pv_count = best_line->pv_count;
+    stack->best_move.set(&pv_move);
+    result_score = best_line->score;
+}
+
+/**
+ * Sends the Multi-PV lines that have been searched, best line first
+ */
+void search_t::send_multi_pv() {
+    const int count = MIN(multi_pv, root.move_count);
+    for (int i = 0; i < count && root.lines[i].depth > 0; i++) {
+        pv_line_t * line = &root.lines[i];
+        uci::send_pv(line->score, line->depth, sel_depth, total_nodes(), game->tm.elapsed(), ttable->hashfull(brd.root_ply),
+                pv_to_string(line->pv_moves, line->pv_count).c_str(), score::EXACT, i + 1);
+    }
+}
+
+/**
+ * Poll to test is the search should be aborted. The clock is read once every 
+ * poll_interval nodes; the interval adapts to the measured search speed so 
+ * that the time between two polls is about POLL_TIME.
  */
 bool search_t::abort(bool force_poll = false) {
-    static const int NODES_BETWEEN_POLLS = 5000;
+    static const int POLL_TIME = 1000; //microseconds
+    static const int MIN_POLL_INTERVAL = 64;
+    static const int MAX_POLL_INTERVAL = 100000;
     bool result = false;
     if (game->max_nodes > 0 && nodes >= game->max_nodes) {
         result = true;
     } else if (stop_all || engine::is_stopped()) {
         result = true;
     } else if (force_poll || --next_poll <= 0) {
-        next_poll = NODES_BETWEEN_POLLS;
-        result = !pondering() && game->tm.time_is_up() && root_stack->best_move.piece > 0;
+        const int64_t now = time_man::now();
+        if (!force_poll) {
+            const int64_t elapsed = MAX(1, now - last_poll);
+            const int64_t target = MIN(int64_t(MAX_POLL_INTERVAL), int64_t(poll_interval) * POLL_TIME / elapsed);
+            poll_interval = range(MIN_POLL_INTERVAL, MAX_POLL_INTERVAL, int(poll_interval + target) / 2);
+            last_poll = now;
+            next_poll = poll_interval;
+        }
+        result = !pondering() && game->tm.time_is_up(now) && root_stack->best_move.piece > 0;
+    }
+    if (result) { //never reset: the flag can be raised by another thread
+        stop_all = true;
     }
-    stop_all = result;
     return result;
 }
 
@@ -270,6 +424,7 @@ void search_t::forward() {
     stack->in_check = false;
     stack->eval_result = score::INVALID;
     brd.forward();
+    ttable->prefetch(brd.stack->tt_key);
     assert(stack == &_stack[brd.ply]);
 }
 
@@ -293,6 +448,13 @@ void search_t::forward(move_t * move, bool gives_check) {
     stack->in_check = gives_check;
     stack->eval_result = score::INVALID;
     brd.forward(move);
+
+    //start loading the hash table entries of the new position into the cache
+    ttable->prefetch(brd.stack->tt_key);
+    ptable->prefetch(brd.stack->pawn_hash);
+    if (ecache) {
+        ecache->prefetch(brd.stack->tt_key);
+    }
     assert(stack == &_stack[brd.ply]);
 }
 
@@ -306,6 +468,14 @@ void search_t::backward(move_t * move) {
     assert(stack == &_stack[brd.ply]);
 }
 
+/**
+ * Total amount of nodes searched, including the nodes of the helper threads
+ * @return node count
+ */
+U64 search_t::total_nodes() {
+    return nodes + pruned_nodes + (thread_id == 0 ? engine::helper_nodes() : 0);
+}
+
 /**
  * Test if the search is pondering
  * @return bool true if pondering 
@@ -319,26 +489,37 @@ bool search_t::pondering() {
  * @return pv string
  */
 std::string search_t::pv_to_string() {
+    return pv_to_string(stack->pv_moves, stack->pv_count);
+}
+
+/**
+ * Converts a principle variation to a string
+ * @param pv_moves the moves
+ * @param pv_count amount of moves
+ * @return pv string
+ */
+std::string search_t::pv_to_string(uint16_t * pv_moves, int pv_count) {
     std::string result = "";
     board_t b;
     b.init(brd.to_string().c_str());
+    move_t m;
 
     //retrieve pv from stack
-    for (int i = 0; i < stack->pv_count; i++) {
-        result += stack->pv_moves[i].to_string() + " ";
-        b.forward(&stack->pv_moves[i]);
+    for (int i = 0; i < pv_count; i++) {
+        m.set(&b, pv_moves[i]);
+        result += m.to_string() + " ";
+        b.forward(&m);
     }
 
     //retrieve extra moves from hash if the pv is short
-    if (stack->pv_count < 8) {
-        int tt_move = 0, tt_flags, tt_score;
-        move_t m;
+    if (pv_count < 8) {
+        int tt_move = 0, tt_flags, tt_score, tt_eval;
         for (int i = 0; i < 8; i++) {
-            trans_table::retrieve(b.stack->tt_key, 0, 0, tt_score, tt_move, tt_flags);
+            ttable->retrieve(b.stack->tt_key, 0, 0, tt_score, tt_move, tt_flags, tt_eval, thread_id);
             if (tt_move == 0) {
                 break;
             }
-            m.set(tt_move);
+            m.set(&b, tt_move);
             result += m.to_string() + " ";
             b.forward(&m);
         }
@@ -354,17 +535,17 @@ std::string search_t::pv_to_string() {
 void search_t::store_pv() {
     board_t b;
     b.init(brd.to_string().c_str());
-    int tt_move = 0, tt_flags, tt_score;
+    int tt_move = 0, tt_flags, tt_score, tt_eval;
     move_t m;
     for (int i = 0; i < stack->pv_count; i++) {
         if (i > 0) {
-            trans_table::retrieve(b.stack->tt_key, 0, 0, tt_score, tt_move, tt_flags);
-            m.set(tt_move);
-            if (m.equals(&stack->pv_moves[i]) == false) {
-                trans_table::store(b.stack->tt_key, 0, 0, 1, 0, m.to_int(), 0);
+            ttable->retrieve(b.stack->tt_key, 0, 0, tt_score, tt_move, tt_flags, tt_eval, thread_id);
+            if (tt_move != stack->pv_moves[i]) {
+                ttable->store(b.stack->tt_key, 0, 0, 1, 0, tt_move, 0, score::INVALID, thread_id);
             }
         }
-        b.forward(&stack->pv_moves[i]);
+        m.set(&b, stack->pv_moves[i]);
+        b.forward(&m);
     }
 }
 
@@ -410,19 +591,23 @@ void search_t::update_killers(move_t * move) {
  */
 int search_t::init_root_moves() {
     root.move_count = 0;
+    root.pv_index = 0;
+    for (int i = 0; i < MAX_MULTI_PV; i++) {
+        root.lines[i].depth = 0;
+    }
     root.moves[0].move.clear();
     root.fifty_count = brd.stack->fifty_count;
     if (brd.stack->fifty_count < 100) {
-        rep_table::store(brd.stack->fifty_count, brd.stack->tt_key);
+        rep_keys[brd.stack->fifty_count] = brd.stack->tt_key;
     } else {
         //it's a draw
     }
-    int tt_move = 0, tt_flags, tt_score;
-    trans_table::retrieve(brd.stack->tt_key, 0, 0, tt_score, tt_move, tt_flags);
-    stack->tt_move.set(tt_move);
+    int tt_move = 0, tt_flags, tt_score, tt_eval;
+    ttable->retrieve(brd.stack->tt_key, 0, 0, tt_score, tt_move, tt_flags, tt_eval, thread_id);
+    stack->tt_move.set(&brd, tt_move);
     root.in_check = brd.in_check();
     stack->tt_key = brd.stack->tt_key;
-    stack->best_move.set(0);
+    stack->best_move.clear();
     for (move_t * move = move::first(this, 1);
             move; move = move::next(this, 1)) {
         int gives_check = brd.gives_check(move);
@@ -465,10 +650,10 @@ bool root_t::is_easy() {
  * Sort algorithm for root moves (simple insertion sort)
  */
 void root_t::sort_moves(move_t * best_move) {
-    for (int j = 1; j < move_count; j++) {
+    for (int j = pv_index + 1; j < move_count; j++) {
         root_move_t rmove = moves[j];
         int i = j - 1;
-        while (i >= 0 && rmove.compare(&moves[i], best_move) > 0) {
+        while (i >= pv_index && rmove.compare(&moves[i], best_move) > 0) {
             moves[i + 1] = moves[i];
             i--;
         }
@@ -528,7 +713,7 @@ int search_t::pvs_root(int alpha, int beta, int depth) {
      * Moves loop
      */
 
-    for (int i = 0; i < root.move_count; i++) {
+    for (int i = root.pv_index; i < root.move_count; i++) {
         root_move_t * rmove = &root.moves[i];
         move_t * move = &rmove->move;
         int nodes_before = nodes;
@@ -536,7 +721,7 @@ int search_t::pvs_root(int alpha, int beta, int depth) {
 
         //go forward and search one level deeper
         forward(move, rmove->gives_check);
-        if (i == 0) {
+        if (i == root.pv_index) {
             score = -pvs(-beta, -alpha, depth - 1);
         } else {
             score = -pvs(-alpha - 1, -alpha, depth - 1);
@@ -556,11 +741,13 @@ int search_t::pvs_root(int alpha, int beta, int depth) {
             rmove->nodes += i;
             stack->best_move.set(move);
             bool exact = score::flags(score, alpha, beta) == score::EXACT;
-            if (exact || false == move->equals(&stack->pv_moves[0])) {
+            if (exact || move->to_int() != stack->pv_moves[0]) {
                 update_pv(&rmove->move);
             }
-            uci::send_pv(best, depth, sel_depth, nodes + pruned_nodes, game->tm.elapsed(),
-                    pv_to_string().c_str(), score::flags(best, alpha, beta));
+            if (thread_id == 0 && multi_pv == 1) {
+                uci::send_pv(best, depth, sel_depth, total_nodes(), game->tm.elapsed(), ttable->hashfull(brd.root_ply),
+                        pv_to_string().c_str(), score::flags(best, alpha, beta));
+            }
             if (!exact) { //adjust asp. window
                 return score;
             }
@@ -589,7 +776,7 @@ bool search_t::is_draw() {
         for (int ply = brd.ply - 4; ply >= stop_ply; ply -= 2) { //draw by repetition
             if (ply >= 0 && get_stack(ply)->tt_key == brd.stack->tt_key) {
                 return true;
-            } else if (ply < 0 && rep_table::retrieve(root.fifty_count + ply) == brd.stack->tt_key) {
+            } else if (ply < 0 && rep_keys[root.fifty_count + ply] == brd.stack->tt_key) {
                 return true;
             }
         }
@@ -666,8 +853,8 @@ int search_t::pvs(int alpha, int beta, int depth) {
 
     const bool pv = alpha + 1 < beta;
     stack->tt_key = brd.stack->tt_key; //needed for testing repetitions
-    int tt_move = 0, tt_flag = 0, tt_score;
-    if (trans_table::retrieve(stack->tt_key, brd.ply, depth, tt_score, tt_move, tt_flag)) {
+    int tt_move = 0, tt_flag = 0, tt_score, tt_eval;
+    if (ttable->retrieve(stack->tt_key, brd.ply, depth, tt_score, tt_move, tt_flag, tt_eval, thread_id)) {
         if (pv && tt_flag == score::EXACT) {
             return tt_score;
         } else if (!pv && tt_score >= beta && tt_flag == score::LOWERBOUND) {
@@ -676,14 +863,14 @@ int search_t::pvs(int alpha, int beta, int depth) {
             return tt_score;
         }
     }
-    stack->tt_move.set(tt_move);
+    stack->tt_move.set(&brd, tt_move);
 
     /*
      * Node pruning
      */
 
     const bool in_check = stack->in_check;
-    const int eval = evaluate(this);
+    const int eval = evaluate(this, tt_eval);
     const bool do_prune_node = eval >= beta && !in_check && !pv && !score::is_mate(beta) && brd.has_pieces(brd.us());
 
     // beta pruning
@@ -814,14 +1001,15 @@ int search_t::pvs(int alpha, int beta, int depth) {
         } else if (score > best) {
             stack->best_move.set(move);
             if (score >= beta) {
-                trans_table::store(stack->tt_key, brd.root_ply, brd.ply, depth, score, move->to_int(), score::LOWERBOUND);
+                ttable->store(stack->tt_key, brd.root_ply, brd.ply, depth, score, move->to_int(), score::LOWERBOUND, stack->eval_result, thread_id);
                 if (!move->capture && !move->promotion && !move->castle) {
                     update_killers(move);
                     update_history(move);
+                    move_t m;
                     for (int i = 0; i < searched_moves; i++) {
-                        move_t * m = &stack->searched[i];
-                        if (!m->capture && !m->promotion && !m->castle) {
-                            history[m->piece][m->tsq] >>= searched_moves;
+                        m.set(&brd, stack->searched[i]);
+                        if (!m.capture && !m.promotion && !m.castle) {
+                            history[m.piece][m.tsq] >>= searched_moves;
                         }
                     }
                 }
@@ -836,7 +1024,7 @@ int search_t::pvs(int alpha, int beta, int depth) {
                 break;
             }
         }
-        stack->searched[searched_moves++].set(move);
+        stack->searched[searched_moves++] = move->to_int();
     } while ((move = move::next(this, depth)));
 
     /*
@@ -850,7 +1038,7 @@ int search_t::pvs(int alpha, int beta, int depth) {
     assert(brd.legal(&stack->best_move));
 
     int flag = score::flags(best, alpha1, beta);
-    trans_table::store(brd.stack->tt_key, brd.root_ply, brd.ply, depth, best, stack->best_move.to_int(), flag);
+    ttable->store(brd.stack->tt_key, brd.root_ply, brd.ply, depth, best, stack->best_move.to_int(), flag, stack->eval_result, thread_id);
     return best;
 }
 
@@ -1001,7 +1189,7 @@ bool search_t::is_killer(move_t * const move) {
  */
 bool search_t::in_searched(move_t* move, int searched_moves) {
     for (int i = 0; i < searched_moves; i++) {
-        if (stack->searched[i].equals(move)) {
+        if (stack->searched[i] == move->to_int()) {
             return true;
         }
     }
@@ -48,12 +48,26 @@ public:
     int compare(root_move_t * m, move_t * best_move);
 };
 
+const int MAX_MULTI_PV = 32;
+
+/**
+ * Principal variation and score of one root move in Multi-PV mode
+ */
+struct pv_line_t {
+    uint16_t pv_moves[MAX_PLY + 1]; //moves encoded with move_t::to_int
+    int pv_count;
+    int score;
+    int depth;
+};
+
 class root_t {
 public:
     root_move_t moves[move::MAX_MOVES];
     int move_count;
     int fifty_count;
     bool in_check;
+    int pv_index; //first move to search, the moves before it are better pv lines
+    pv_line_t lines[MAX_MULTI_PV];
 
     bool is_complex();
     bool is_easy();
@@ -63,15 +77,16 @@ public:
 
 struct search_stack_t {
     move::list_t move_list;
-    move_t searched[256];
+    uint16_t searched[256]; //moves encoded with move_t::to_int
     move_t current_move;
     move_t best_move;
     move_t tt_move;
     move_t killer[2];
-    move_t pv_moves[MAX_PLY + 1];
+    uint16_t pv_moves[MAX_PLY + 1];
     bool in_check;
     uint8_t pv_count;
     int16_t eval_result;
+    bool full_eval; //pc_score, attack and king_attack are calculated, not taken from the hash table
     int16_t eg_score;
     score_t eval_score;
     score_t pc_score[BKING + 1];
@@ -93,18 +108,33 @@ public:
     search_stack_t * root_stack;
     U64 nodes;
     U64 pruned_nodes;
-    bool stop_all;
+    U64 evals; //calculated evaluations
+    U64 tt_evals; //evaluations taken from the transposition table
+    U64 cached_evals; //evaluations taken from the evaluation cache
+    volatile bool stop_all;
     int next_poll;
+    int poll_interval;
+    int64_t last_poll;
     int sel_depth;
     int result_score;
+    int result_depth;
+    int thread_id;
+    pawn_table::table_t * ptable;
+    material_table::table_t * mtable;
+    trans_table_t * ttable;
+    eval_cache::table_t * ecache; //NULL: evaluations are not cached
     int history[BKING + 1][64];
+    U64 rep_keys[100]; //game history keys, indexed by fifty move count
     move_t ponder_move;
     std::string book_name;
     bool root_wtm;
     int wild;
     int king_attack_shelter;
     int king_attack_pieces;
+    int piece_activity;
+    int passed_pawns;
     int draw_contempt;
+    int multi_pv;
     bool null_verify;
     bool null_enabled;
     bool beta_pruning;
@@ -118,19 +148,33 @@ public:
     virtual ~search_t() {
     };
     void init(const char * fen, game_t * g);
+
+    /**
+     * Prepares a (reused) search object for a new search
+     */
+    virtual void reset(const char * fen, game_t * g) {
+        init(fen, g);
+    }
+    void set_thread(int id);
+    int * param(const std::string & name);
     void go();
     void book_calc();
     void iterative_deepening();
+    bool skip_depth(int depth);
     int aspiration(int depth, int last_score);
+    void multi_pv_search(int depth);
+    void send_multi_pv();
     bool book_lookup();
     int pvs_root(int alpha, int beta, int depth);
     virtual int pvs(int alpha, int beta, int depth);
     int qsearch(int alpha, int beta, int depth);
     int qstatic(int beta, int gain);
     std::string pv_to_string();
+    std::string pv_to_string(uint16_t * pv_moves, int pv_count);
     bool is_draw();
     bool abort(bool force_poll);
     bool pondering();
+    U64 total_nodes();
     int init_root_moves();
     void store_pv();
     void debug_print_search(int alpha, int beta, int depth);
@@ -186,8 +230,8 @@ public:
     }
 
     void update_pv(move_t * move) {
-        stack->pv_moves[0].set(move);
-        memcpy(stack->pv_moves + 1, (stack + 1)->pv_moves, (stack + 1)->pv_count * sizeof (move_t));
+        stack->pv_moves[0] = move->to_int();
+        memcpy(stack->pv_moves + 1, (stack + 1)->pv_moves, (stack + 1)->pv_count * sizeof (uint16_t));
         stack->pv_count = (stack + 1)->pv_count + 1;
     }
 };
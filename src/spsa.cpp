@@ -0,0 +1,142 @@
+/**
+ * Maxima, a chess playing program.
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *
+ * File: spsa.cpp
+ * SPSA parameter tuning, see spsa.h
+ */
+
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "spsa.h"
+
+/**
+ * Reads the parameter file. Empty lines and lines starting with # are skipped.
+ * @param file_name parameter file
+ * @return true if the file could be read and holds at least one parameter
+ */
+bool spsa_t::load(const std::string & file_name) {
+    std::ifstream file(file_name.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    count = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream parser(line);
+        std::string token;
+        if (!(parser >> token) || token[0] == '#') {
+            continue;
+        } else if (token == "iterations") {
+            parser >> iterations;
+        } else if (token == "iteration") {
+            parser >> iteration;
+        } else if (token == "pairs") {
+            parser >> pairs;
+        } else if (token == "depth") {
+            parser >> depth;
+        } else if (count < MAX_SPSA_PARAMS) {
+            param_t & p = params[count];
+            p.name = token;
+            if (!(parser >> p.value >> p.min >> p.max >> p.c_end >> p.r_end) || p.min > p.max) {
+                return false;
+            }
+            p.value = _clamp(p, p.value);
+            count++;
+        }
+    }
+    return count > 0 && iterations > 0 && pairs > 0 && depth > 0;
+}
+
+/**
+ * Writes the parameter file. A temporary file is renamed, so a crash while
+ * saving does not destroy the last checkpoint.
+ * @param file_name parameter file
+ * @return true if successful
+ */
+bool spsa_t::save(const std::string & file_name) {
+    std::string tmp_name = file_name + ".tmp";
+    std::ofstream file(tmp_name.c_str());
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "# name value min max c_end r_end" << std::endl;
+    file << "iterations " << iterations << std::endl;
+    file << "pairs " << pairs << std::endl;
+    file << "depth " << depth << std::endl;
+    file << "iteration " << iteration << std::endl;
+    file.precision(10);
+    for (int i = 0; i < count; i++) {
+        const param_t & p = params[i];
+        file << p.name << " " << p.value << " " << p.min << " " << p.max
+                << " " << p.c_end << " " << p.r_end << std::endl;
+    }
+    file.close();
+    return !file.fail() && rename(tmp_name.c_str(), file_name.c_str()) == 0;
+}
+
+/**
+ * Randomly flips the direction of each parameter and calculates both
+ * perturbed parameter vectors for the next iteration
+ * @param plus parameter values, moved in the flip direction
+ * @param minus parameter values, moved against the flip direction
+ */
+void spsa_t::perturb(int * plus, int * minus) {
+    for (int i = 0; i < count; i++) {
+        const param_t & p = params[i];
+        flip[i] = (rand() & 1) ? 1 : -1;
+        double c = _c_k(p) * flip[i];
+        plus[i] = lround(_clamp(p, p.value + c));
+        minus[i] = lround(_clamp(p, p.value - c));
+    }
+}
+
+/**
+ * Moves the parameters in the direction of the winning vector and advances
+ * to the next iteration
+ * @param result wins minus losses of the plus vector
+ */
+void spsa_t::update(int result) {
+    for (int i = 0; i < count; i++) {
+        param_t & p = params[i];
+        p.value = _clamp(p, p.value + _a_k(p) / _c_k(p) * result * flip[i]);
+    }
+    iteration++;
+}
+
+/**
+ * Perturbation size of the next iteration, decreasing to c_end
+ */
+double spsa_t::_c_k(const param_t & p) {
+    return p.c_end * pow(iterations, spsa::GAMMA) / pow(iteration + 1, spsa::GAMMA);
+}
+
+/**
+ * Step size of the next iteration, the learning rate r_end is reached at
+ * the last iteration: a_end = r_end * c_end^2
+ */
+double spsa_t::_a_k(const param_t & p) {
+    const double A = 0.1 * iterations;
+    const double a = p.r_end * p.c_end * p.c_end * pow(A + iterations, spsa::ALPHA);
+    return a / pow(A + iteration + 1, spsa::ALPHA);
+}
+
+double spsa_t::_clamp(const param_t & p, double value) {
+    return value < p.min ? p.min : value > p.max ? p.max : value;
+}
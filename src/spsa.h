@@ -0,0 +1,95 @@
+/**
+ * Maxima, a chess playing program.
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *
+ * File: spsa.h
+ * Simultaneous Perturbation Stochastic Approximation (SPSA) of a vector of
+ * integer search and evaluation parameters.
+ *
+ * The parameter file is also the checkpoint: it is rewritten after each
+ * iteration, so an interrupted run resumes where it stopped. Example:
+ *
+ * iterations 2000
+ * pairs 16
+ * depth 2
+ * iteration 0
+ * KingAttackShelter 256 0 512 20 0.002
+ * DrawContempt -10 -100 100 5 0.002
+ *
+ * Each parameter line holds: name, value, min, max, c_end and r_end. c_end is
+ * the perturbation size and r_end the learning rate at the last iteration.
+ */
+
+#ifndef SPSA_H
+#define	SPSA_H
+
+#include <string>
+
+#define MAX_SPSA_PARAMS 64
+
+namespace spsa {
+    const double ALPHA = 0.602;
+    const double GAMMA = 0.101;
+};
+
+class spsa_t {
+public:
+
+    struct param_t {
+        std::string name;
+        double value;
+        double min;
+        double max;
+        double c_end;
+        double r_end;
+    };
+
+    param_t params[MAX_SPSA_PARAMS];
+    int flip[MAX_SPSA_PARAMS];
+    int count;
+    int iterations;
+    int iteration;
+    int pairs;
+    int depth;
+
+    spsa_t() {
+        count = 0;
+        iterations = 1000;
+        iteration = 0;
+        pairs = 8;
+        depth = 2;
+        for (int i = 0; i < MAX_SPSA_PARAMS; i++) {
+            flip[i] = 1;
+        }
+    }
+
+    bool load(const std::string & file_name);
+    bool save(const std::string & file_name);
+    void perturb(int * plus, int * minus);
+    void update(int result);
+
+    bool done() {
+        return iteration >= iterations;
+    }
+
+private:
+    double _c_k(const param_t & p);
+    double _a_k(const param_t & p);
+    double _clamp(const param_t & p, double value);
+};
+
+#endif	/* SPSA_H */
+
@@ -111,6 +111,130 @@ private:
      */
 };
 
+/**
+ * Pool of long-lived worker threads. A worker is created the first time a
+ * job is started on it; after finishing the job it parks on a condition
+ * variable until the next job, so no threads are created or joined per search.
+ */
+class pool_t {
+public:
+
+    pool_t() {
+        _count = 0;
+        _quit = false;
+        pthread_mutex_init(&_mutex, NULL);
+        pthread_cond_init(&_cond, NULL);
+        pthread_cond_init(&_done, NULL);
+    }
+
+    ~pool_t() {
+        pthread_mutex_lock(&_mutex);
+        _quit = true;
+        pthread_cond_broadcast(&_cond);
+        pthread_mutex_unlock(&_mutex);
+        for (int i = 0; i < _count; i++) {
+            pthread_join(_workers[i].thread, NULL);
+        }
+        pthread_mutex_destroy(&_mutex);
+        pthread_cond_destroy(&_cond);
+        pthread_cond_destroy(&_done);
+    }
+
+    /**
+     * Starts a job on a worker thread, creating the worker(s) if needed
+     * @param ix worker index
+     * @param function_ptr the job
+     * @param params job parameter
+     * @return true if the job was started
+     */
+    bool start(int ix, void* function_ptr(void *ptr), void* params) {
+        if (ix < 0 || ix >= MAX_THREADS) {
+            return false;
+        }
+        pthread_mutex_lock(&_mutex);
+        while (ix < _count && _workers[ix].busy) {
+            pthread_cond_wait(&_done, &_mutex);
+        }
+        bool result = true;
+        while (_count <= ix && result) {
+            worker_t * w = &_workers[_count];
+            w->pool = this;
+            w->function = NULL;
+            w->params = NULL;
+            w->busy = false;
+            result = pthread_create(&w->thread, NULL, _loop, w) == 0;
+            _count += result;
+        }
+        if (result) {
+            _workers[ix].function = function_ptr;
+            _workers[ix].params = params;
+            _workers[ix].busy = true;
+            pthread_cond_broadcast(&_cond);
+        }
+        pthread_mutex_unlock(&_mutex);
+        return result;
+    }
+
+    /**
+     * Waits until a worker has finished its job
+     * @param ix worker index
+     */
+    void wait_for(int ix) {
+        pthread_mutex_lock(&_mutex);
+        while (ix < _count && _workers[ix].busy) {
+            pthread_cond_wait(&_done, &_mutex);
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    /**
+     * Waits until all workers have finished their jobs
+     */
+    void wait_all() {
+        for (int i = 0; i < _count; i++) {
+            wait_for(i);
+        }
+    }
+
+private:
+
+    struct worker_t {
+        pthread_t thread;
+        pool_t * pool;
+        void* (*function)(void *ptr);
+        void* params;
+        bool busy;
+    };
+
+    int _count;
+    bool _quit;
+    worker_t _workers[MAX_THREADS];
+    pthread_mutex_t _mutex;
+    pthread_cond_t _cond;
+    pthread_cond_t _done;
+
+    static void * _loop(void * worker_p) {
+        worker_t * w = (worker_t*) worker_p;
+        pool_t * pool = w->pool;
+        pthread_mutex_lock(&pool->_mutex);
+        while (true) {
+            while (!w->busy && !pool->_quit) {
+                pthread_cond_wait(&pool->_cond, &pool->_mutex);
+            }
+            if (!w->busy) {
+                break;
+            }
+            pthread_mutex_unlock(&pool->_mutex);
+            w->function(w->params);
+            pthread_mutex_lock(&pool->_mutex);
+            w->busy = false;
+            pthread_cond_broadcast(&pool->_done);
+        }
+        pthread_mutex_unlock(&pool->_mutex);
+        return NULL;
+    }
+};
+
 
 #endif	/* THREADMAN_H */
 
@@ -32,7 +32,6 @@
 class time_manager_t;
 
 namespace time_man {
-    const double ONE_MS = CLOCKS_PER_SEC / 1000;
     const int INFINITE_TIME = 24 * 60 * 60 * 1000;
     const int M = 24; //assume game is decided after M moves from now
     const int M_MIN = M*2;
@@ -41,13 +40,23 @@ namespace time_man {
     const int M_MAX_LOW_TIME = M;
     const int LOW_TIME = 60000; //one minute
     const int LAG_TIME = 50; //interface + initialization lag time in ms per move
+
+    /**
+     * Monotonic wall clock time in microseconds. On Linux this is served 
+     * by the vDSO, so it costs no system call.
+     */
+    inline int64_t now() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+    }
 };
 
 class time_manager_t {
 private:
-    clock_t start; //in ticks
-    clock_t min; //minimum time to use, in ticks
-    clock_t max; //maximum time to use, in ticks 
+    int64_t start; //in microseconds
+    int64_t min; //minimum time to use, in microseconds
+    int64_t max; //maximum time to use, in microseconds
     int tot_min;
     int tot_max;
 
@@ -56,45 +65,52 @@ public:
     void clear();
     void set(const int my_time, const int opp_time, const int my_inc, const int opp_inc, const int moves_left);
     
-    clock_t ticks(const int time_in_ms) {
-        return time_in_ms * time_man::ONE_MS;
+    int64_t micros(const int time_in_ms) {
+        return int64_t(time_in_ms) * 1000;
     }
 
     void set_start() {
-        start = clock();
+        start = time_man::now();
     }
 
     void set_min(const int ms) {
-        min = start + ticks(ms);
+        min = start + micros(ms);
     }
     
     void set_max(const int ms) {
-        max = start + ticks(ms);
+        max = start + micros(ms);
     }
     
     int get_min() {
-        return min;
+        return (min - start) / 1000;
     }
 
     bool time_is_up() {
-        return clock() >= max;
+        return time_is_up(time_man::now());
+    }
+
+    /**
+     * Test if time is up, using a time read before by the caller
+     * @param now time in microseconds
+     */
+    bool time_is_up(const int64_t now) {
+        return now >= max;
     }
 
     int elapsed() {
-        clock_t ticks = clock() - start;
-        return ticks / time_man::ONE_MS;
+        return (time_man::now() - start) / 1000;
     }
     
     int reserved_min() {
         if (tot_min <= 0) {
-            tot_min = (min - start) / time_man::ONE_MS;
+            tot_min = (min - start) / 1000;
         }
         return tot_min;
     }
     
     int reserved_max() {
         if (tot_max <= 0) {
-            tot_max = (max - start) / time_man::ONE_MS;
+            tot_max = (max - start) / 1000;
         }
         return tot_max;
     }
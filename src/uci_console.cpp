@@ -103,9 +103,15 @@ namespace uci {
             } else if (token == "eval") {
                 result = handle_eval(parser);
             } else if (token == "learn") {
-                result = handle_learn();
+                result = handle_learn(parser);
             } else if (token == "book") {
                 result = handle_book(parser);
+            } else if (token == "bench") {
+                result = handle_bench(parser);
+            } else if (token == "perft") {
+                result = handle_perft(parser);
+            } else if (token == "hashstats") {
+                result = handle_hashstats();
             }
         }
         return result;
@@ -114,11 +120,16 @@ namespace uci {
     bool handle_uci() {
         send_id();
         send_options();
+        send_string(trans_table::info());
         send_ok();
         return true;
     }
 
     bool handle_isready() {
+        int clear_ms = trans_table::clear_time();
+        if (clear_ms >= 0) {
+            send_string("hash cleared in " + itoa(clear_ms) + " ms");
+        }
         send_ready();
         return true;
     }
@@ -261,7 +272,15 @@ namespace uci {
 
                         //handle option
                         if (name == "Hash") {
+                            engine::stop(); //the table is cleared on the workers of the search threads
                             trans_table::set_size(opt->value);
+                            send_string(trans_table::info());
+                        } else if (name == "PawnHash") {
+                            pawn_table::set_size(opt->value);
+                        } else if (name == "MaterialHash") {
+                            material_table::set_size(opt->value);
+                        } else {
+                            eval_cache::clear(); //the evaluation parameters may have changed
                         }
                     }
                 }
@@ -280,14 +299,20 @@ namespace uci {
 
     /*
      * Learn can be used to determine if a new evaluation or search
-     * feature gives better performance, and what is the ideal score
-     *
+     * feature gives better performance, and what is the ideal score.
+     * "learn spsa <paramfile>" tunes a vector of parameters with SPSA
      */
-    bool handle_learn() {
+    bool handle_learn(input_parser_t & parser) {
         engine::settings()->clear();
         engine::set_ponder(false);
         engine::set_position(fen);
-        engine::learn();
+        std::string token;
+        std::string file_name;
+        if (parser >> token && token == "spsa" && parser >> file_name) {
+            engine::spsa(file_name);
+        } else {
+            engine::learn();
+        }
         return true;
     }
 
@@ -313,6 +338,73 @@ namespace uci {
         return true;
     }
 
+    /*
+     * Bench searches a fixed set of positions: bench [depth] [threads] [hash]
+     */
+    bool handle_bench(input_parser_t & parser) {
+        int depth = 10;
+        int threads = 1;
+        int hash = 64;
+        std::string token;
+        if (parser >> token) {
+            depth = atoi<int>(token);
+        }
+        if (parser >> token) {
+            threads = atoi<int>(token);
+        }
+        if (parser >> token) {
+            hash = atoi<int>(token);
+        }
+        engine::stop();
+        engine::set_ponder(false);
+        engine::bench(range(1, MAX_PLY - 1, depth), threads, MAX(1, hash));
+        engine::new_game(fen);
+        return true;
+    }
+
+    /*
+     * Perft counts the leaf nodes of the actual position: perft [depth] [threads] [hash]
+     * The perft table (hash, in MB) is allocated next to the hash table and 
+     * defaults to perft_table::TABLE_SIZE, 0 for no table
+     */
+    bool handle_perft(input_parser_t & parser) {
+        int depth = 5;
+        int threads = options::get_value("Threads");
+        int hash = perft_table::TABLE_SIZE;
+        std::string token;
+        if (parser >> token) {
+            depth = atoi<int>(token);
+        }
+        if (parser >> token) {
+            threads = atoi<int>(token);
+        }
+        if (parser >> token) {
+            hash = atoi<int>(token);
+        }
+        engine::stop();
+        engine::set_position(fen);
+        engine::perft(range(1, MAX_PLY - 1, depth), threads, MAX(0, hash));
+        return true;
+    }
+
+    /*
+     * Hashstats reports the counters of the hash, pawn and material tables
+     * and the usage of the hash table by the last search
+     */
+    bool handle_hashstats() {
+        hash_stats_t stats;
+        trans_table::stats(stats);
+        send_string(hash_stats_to_string("hash", stats));
+        pawn_table::stats(stats);
+        send_string(hash_stats_to_string("pawn table", stats));
+        material_table::stats(stats);
+        send_string(hash_stats_to_string("material table", stats));
+        board_t brd;
+        brd.init(fen.c_str());
+        send_string("hashfull " + itoa(trans_table::hashfull(brd.root_ply)) + " permille");
+        return true;
+    }
+
     /*
      * Book handles commands for book making / learning
      */
@@ -357,8 +449,17 @@ namespace uci {
         out("info string " + msg);
     }
 
-    void send_pv(int cp_score, int depth, int sel_depth, U64 nodes, int time, const char * pv, int flag) {
+    std::string hash_stats_to_string(const char * name, const hash_stats_t & stats) {
+        return std::string(name) + " hits " + itoa(stats.hits * 100 / MAX(1, stats.probes)) + "% of "
+                + itoa(stats.probes) + " probes, " + itoa(stats.stores) + " stores, "
+                + itoa(stats.overwrites) + " overwrites, " + itoa(stats.collisions) + " collisions";
+    }
+
+    void send_pv(int cp_score, int depth, int sel_depth, U64 nodes, int time, int hashfull, const char * pv, int flag, int multi_pv) {
         std::string msg = "info depth " + itoa(depth) + " seldepth " + itoa(MAX(depth, sel_depth));
+        if (multi_pv > 0) {
+            msg += " multipv " + itoa(multi_pv);
+        }
         if (ABS(cp_score) < score::DEEPEST_MATE) {
             msg += " score cp " + itoa(cp_score);
             if (flag == score::UPPERBOUND) {
@@ -373,7 +474,7 @@ namespace uci {
         }
         msg += " nodes " + itoa(nodes) + " time " + itoa(time) + " nps ";
         int nps = time < 50 ? nodes : (1000 * U64(nodes)) / time;
-        msg += itoa(nps) + " pv " + pv;
+        msg += itoa(nps) + " hashfull " + itoa(hashfull) + " pv " + pv;
         out(msg);
     }
 
@@ -55,17 +55,21 @@ namespace uci {
     bool handle_forward(input_parser_t & p);
     bool handle_setoption(input_parser_t &parser);
     bool handle_eval(input_parser_t &parser);
-    bool handle_learn();
+    bool handle_learn(input_parser_t & parser);
     bool handle_book(input_parser_t &parser);
+    bool handle_bench(input_parser_t &parser);
+    bool handle_perft(input_parser_t &parser);
+    bool handle_hashstats();
     
     void send_id();
     void send_options();
     void send_ok();   
     void send_ready();
-    void send_pv(int cp_score, int depth, int sel_depth, U64 nodes, int time, const char * pv, int flag); 
+    void send_pv(int cp_score, int depth, int sel_depth, U64 nodes, int time, int hashfull, const char * pv, int flag, int multi_pv = 0); 
     void send_bestmove(move_t move, move_t ponder_move);
     void send_unknown_option(std::string option);
     void send_string(std::string msg);
+    std::string hash_stats_to_string(const char * name, const hash_stats_t & stats);
 }
 
 #endif	/* UCI_CONSOLE_H */
@@ -0,0 +1,28 @@
+/**
+ * Maxima, a chess playing program.
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *
+ * File: version.h.in
+ * Includes external version information, e.g git build hash
+ * This file is managed by CMake
+ */
+
+#ifndef VERSION_H_IN
+#define	VERSION_H_IN
+
+#define MAXIMA_REVISION "2.0.0-master-8d0cd98-Debug"
+
+#endif	/* VERSION_H_IN */
@@ -45,7 +45,7 @@ int w17_eval_material(w17_search_t * s) {
      */
 
     board_t * brd = &s->brd;
-    s->stack->mt = material_table::retrieve(brd->stack->material_hash);
+    s->stack->mt = s->mtable->retrieve(brd->stack->material_hash);
     if (s->stack->mt->key == brd->stack->material_hash) {
         return s->stack->mt->score;
     }
@@ -180,7 +180,7 @@ score_t * w17_eval_pawns_and_kings(search_t * s) {
      * 1. Probe the hash table for the pawn score
      */
     
-    s->stack->pt = pawn_table::retrieve(s->brd.stack->pawn_hash);
+    s->stack->pt = s->ptable->retrieve(s->brd.stack->pawn_hash);
     if (s->stack->pt->key == s->brd.stack->pawn_hash) {
         return &s->stack->pt->score;
     }
@@ -43,7 +43,7 @@ bool w17_search_t::w17_is_draw() {
         for (int ply = brd.ply - 4; ply >= stop_ply; ply -= 2) { //draw by repetition
             if (ply >= 0 && get_stack(ply)->tt_key == brd.stack->tt_key) {
                 return true;
-            } else if (ply < 0 && rep_table::retrieve(root.fifty_count + ply) == brd.stack->tt_key) {
+            } else if (ply < 0 && rep_keys[root.fifty_count + ply] == brd.stack->tt_key) {
                 return true;
             }
         }
@@ -115,8 +115,8 @@ int w17_search_t::w17_pvs(int alpha, int beta, int in_mate_search, int depth) {
      */
 
     stack->tt_key = brd.stack->tt_key; //needed for testing repetitions
-    int tt_move = 0, tt_flag = 0, tt_score;
-    if (depth > 0 && trans_table::retrieve(stack->tt_key, brd.ply, depth, tt_score, tt_move, tt_flag)) {
+    int tt_move = 0, tt_flag = 0, tt_score, tt_eval;
+    if (depth > 0 && ttable->retrieve(stack->tt_key, brd.ply, depth, tt_score, tt_move, tt_flag, tt_eval, thread_id)) {
         if ((tt_flag == score::LOWERBOUND && tt_score >= beta)
                 || (tt_flag == score::UPPERBOUND && tt_score <= alpha)
                 || tt_flag == score::EXACT) {
@@ -130,7 +130,7 @@ int w17_search_t::w17_pvs(int alpha, int beta, int in_mate_search, int depth) {
      * are a win in losers chess
      */
 
-    stack->tt_move.set(tt_move);
+    stack->tt_move.set(&brd, tt_move);
     move_t * move = move::first(this, 0);
     if (!move) {
         return score::MATE - brd.ply;
@@ -204,16 +204,17 @@ int w17_search_t::w17_pvs(int alpha, int beta, int in_mate_search, int depth) {
             if (score >= beta) {
 
                 if (depth > 0) {
-                    trans_table::store(brd.stack->tt_key, brd.root_ply, brd.ply, depth, score, move->to_int(), score::LOWERBOUND);
+                    ttable->store(brd.stack->tt_key, brd.root_ply, brd.ply, depth, score, move->to_int(), score::LOWERBOUND, score::INVALID, thread_id);
                 }
 
                 if (depth > 0 && !move->capture && !move->promotion && !move->castle) {
                     update_killers(move);
                     update_history(move);
+                    move_t m;
                     for (int i = 0; i < searched_moves; i++) {
-                        move_t * m = &stack->searched[i];
-                        if (!m->capture && !m->promotion) {
-                            history[m->piece][m->tsq] >>= searched_moves;
+                        m.set(&brd, stack->searched[i]);
+                        if (!m.capture && !m.promotion) {
+                            history[m.piece][m.tsq] >>= searched_moves;
                         }
                     }
                 }
@@ -228,7 +229,7 @@ int w17_search_t::w17_pvs(int alpha, int beta, int in_mate_search, int depth) {
                 break;
             }
         }
-        stack->searched[searched_moves++].set(move);
+        stack->searched[searched_moves++] = move->to_int();
     } while ((move = move::next(this, 0)));
 
     /*
@@ -241,7 +242,7 @@ int w17_search_t::w17_pvs(int alpha, int beta, int in_mate_search, int depth) {
 
     if (depth > 0) {
         int flag = score::flags(best, alpha1, beta); 
-        trans_table::store(brd.stack->tt_key, brd.root_ply, brd.ply, depth, best, stack->best_move.to_int(), flag);
+        ttable->store(brd.stack->tt_key, brd.root_ply, brd.ply, depth, best, stack->best_move.to_int(), flag, score::INVALID, thread_id);
     }
 
     return best;
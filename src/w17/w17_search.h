@@ -34,6 +34,15 @@ public:
     bool w17_is_draw();
 
     w17_search_t(const char * fen, game_t * g = NULL) : search_t(fen, g) {
+        w17_init();
+    }
+
+    virtual void reset(const char * fen, game_t * g) {
+        init(fen, g);
+        w17_init();
+    }
+
+    void w17_init() {
         wild = 17;
         book_name = "book.w17.bin";
         
@@ -0,0 +1,60 @@
+/**
+ * Maxima, a chess playing program. 
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma 
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *  
+ * File:   test_bench.cpp
+ * Bench command: the single threaded node count signature must be deterministic
+ */
+
+#include "engine.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+const int TEST_DEPTH = 6;
+
+/**
+ * Node signature of "bench 6". A change that alters the search on purpose 
+ * must update it, any other change must leave it as is.
+ */
+const U64 TEST_SIGNATURE = 670456;
+
+void test_bench() {
+    magic::init();
+    U64 first = engine::bench(TEST_DEPTH, 1, 16);
+    U64 second = engine::bench(TEST_DEPTH, 1, 16);
+    if (first == 0 || first != second) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_bench (test_bench) message=signature "
+                << first << " != " << second << std::endl;
+    } else if (first != TEST_SIGNATURE) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_bench (test_bench) message=signature "
+                << first << ", expected " << TEST_SIGNATURE << std::endl;
+    }
+}
+
+int main() {
+    std::cout << "%SUITE_STARTING% test_bench" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_bench (test_bench)\n" << std::endl;
+    test_bench();
+    std::cout << "%TEST_FINISHED% time=0 test_bench (test_bench)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
@@ -224,6 +224,58 @@ int main() {
     delete brd;
     std::cout << "   done" << std::endl << std::endl;
 
+    /*
+     * Sliding piece attacks: magic and pext backends must be identical
+     */
+    std::cout << "6. slider attacks test" << std::endl;
+    magic::init();
+    const bool pext = magic::pext_supported();
+    const int OCC_COUNT = 1024;
+    U64 occs[OCC_COUNT];
+    srand(42);
+    for (int i = 0; i < OCC_COUNT; i++) {
+        occs[i] = (U64(rand()) << 40 ^ U64(rand()) << 20 ^ U64(rand())) & (U64(rand()) << 33 ^ U64(rand()));
+    }
+    if (!pext) {
+        std::cout << "   pext not supported, skipped" << std::endl;
+    }
+    for (int i = 0; pext && i < OCC_COUNT; i++) {
+        for (sq = 0; sq < 64; sq++) {
+            magic::select_pext(false);
+            U64 bishop = magic::bishop_moves(sq, occs[i]);
+            U64 rook = magic::rook_moves(sq, occs[i]);
+            magic::select_pext(true);
+            if (bishop != magic::bishop_moves(sq, occs[i]) || rook != magic::rook_moves(sq, occs[i])) {
+                std::cout << "%TEST_FAILED% time=0 testname=test_bits (test_bits) message=pext != magic: sq "
+                        << sq << " occ " << occs[i] << std::endl;
+                i = OCC_COUNT;
+                break;
+            }
+        }
+    }
+    std::cout << "   done" << std::endl << std::endl;
+
+    /*
+     * Sliding piece attacks micro benchmark
+     */
+    std::cout << "7. slider attacks benchmark" << std::endl;
+    const int ROUNDS = 5000;
+    for (int backend = 0; backend <= int(pext); backend++) {
+        magic::select_pext(backend);
+        U64 sum = 0;
+        int64_t start = time_man::now();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (int i = 0; i < OCC_COUNT; i++) {
+                sum ^= magic::rook_moves((i + r) & 63, occs[i]) + magic::bishop_moves(i & 63, occs[i]);
+            }
+        }
+        int64_t elapsed = time_man::now() - start + 1;
+        std::cout << "   " << (backend ? "pext " : "magic") << ": "
+                << 2 * ROUNDS * OCC_COUNT / elapsed << "M attacks/s (" << (sum & 1) << ")" << std::endl;
+    }
+    magic::init();
+    std::cout << "   done" << std::endl << std::endl;
+
     /*
      * Finalize
      */
@@ -0,0 +1,140 @@
+/**
+ * Maxima, a chess playing program. 
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma 
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *  
+ * File:   test_endgame.cpp
+ * Endgame evaluators: dispatch by material signature and a benchmark of the
+ * endgame evaluation and search on a set of endgame positions
+ */
+
+#include <cstring>
+#include "engine.h"
+#include "eval_endgame.h"
+#include "eval_material.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+const int TEST_DEPTH = 10;
+const int EVAL_CALLS = 200000;
+
+struct endgame_position_t {
+    const char * fen;
+    bool us; //winning side
+    const char * signature; //NULL: generic evaluator
+};
+
+const endgame_position_t POSITIONS[] = {
+    {"8/8/8/4k3/8/8/4P3/4K3 w - - 0 1", WHITE, "KPK"},
+    {"8/8/8/4k3/8/8/P7/3NK3 w - - 0 1", WHITE, "KNPK"},
+    {"8/8/8/4k3/8/8/P7/2B1K3 w - - 0 1", WHITE, "KBP+K"},
+    {"8/7p/8/4k3/8/8/P7/2B1K3 w - - 0 1", WHITE, "KBP+KP+"},
+    {"8/8/8/4k3/8/3p4/8/R3K3 w - - 0 1", WHITE, "KRKP"},
+    {"q7/8/8/8/8/8/1P6/4K2k b - - 0 1", BLACK, "KQKP"},
+    {"8/8/8/4k3/3n4/8/8/2B1KB2 w - - 0 1", WHITE, "KBBKN"},
+    {"7r/8/8/4k3/8/8/4P3/R3K3 w - - 0 1", WHITE, "KRPKR"},
+    {"7q/8/8/4k3/8/8/4P3/1Q2K3 w - - 0 1", WHITE, "KQP+KQ"},
+    {"4b3/5p2/8/4k3/8/8/4P3/2B1K3 w - - 0 1", WHITE, "KBP+KBP+"},
+    {"7q/5p2/8/4k3/8/8/4P3/1Q2K3 w - - 0 1", WHITE, "KQP+KQP+"},
+    {"8/8/8/4k3/8/8/8/R3K3 w - - 0 1", WHITE, NULL},
+    {"8/5pp1/8/4k3/8/8/4PP2/4K3 w - - 0 1", WHITE, NULL},
+    {"8/5pp1/8/4k3/8/8/4PP2/2N1K3 w - - 0 1", WHITE, NULL}
+};
+
+const int POSITION_COUNT = sizeof (POSITIONS) / sizeof (POSITIONS[0]);
+
+/**
+ * Each material configuration selects its evaluator once, through the 
+ * material table
+ */
+void testDispatch() {
+    for (int i = 0; i < POSITION_COUNT; i++) {
+        const endgame_position_t & p = POSITIONS[i];
+        search_t * s = new search_t(p.fen);
+        evaluate(s);
+        const char * signature = eg::signature(s->stack->mt->endgame[p.us]);
+        bool same = signature == p.signature || (signature && p.signature && strcmp(signature, p.signature) == 0);
+        if (!same || !material::is_eg(s)) {
+            std::cout << "%TEST_FAILED% time=0 testname=testDispatch (test_endgame) message=" << p.fen
+                    << " evaluator " << (signature ? signature : "generic") << std::endl;
+        }
+        delete s;
+    }
+}
+
+/**
+ * Time spent in the endgame evaluation and search speed on the endgame positions
+ */
+void testBenchmark() {
+    int64_t eval_time = 0; //microseconds
+    int64_t checksum = 0;
+    for (int i = 0; i < POSITION_COUNT; i++) {
+        const endgame_position_t & p = POSITIONS[i];
+        search_t * s = new search_t(p.fen);
+        evaluate(s);
+        const int score = p.us == WHITE ? 200 : -200;
+        int64_t begin = time_man::now();
+        for (int j = 0; j < EVAL_CALLS; j++) {
+            checksum += eg::eval(s, score + (j & 1));
+        }
+        eval_time += time_man::now() - begin;
+        delete s;
+    }
+    std::cout << "endgame evaluation: " << eval_time * 1000.0 / (EVAL_CALLS * POSITION_COUNT)
+            << " ns per call (checksum " << checksum << ")" << std::endl;
+
+    uci::silent(true);
+    engine_t * engine = engine::instance();
+    options::get_option("Threads")->value = 1;
+    U64 total_nodes = 0;
+    int64_t total_time = 0; //microseconds
+    for (int i = 0; i < POSITION_COUNT; i++) {
+        engine->settings()->clear();
+        engine->settings()->max_depth = TEST_DEPTH;
+        engine->new_game(POSITIONS[i].fen);
+        int64_t begin = time_man::now();
+        engine->think();
+        engine->wait();
+        total_time += time_man::now() - begin;
+        total_nodes += engine->get_total_nodes();
+        if (engine->get_move().piece == 0) {
+            std::cout << "%TEST_FAILED% time=0 testname=testBenchmark (test_endgame) message=no best move: "
+                    << POSITIONS[i].fen << std::endl;
+        }
+    }
+    uci::silent(false);
+    std::cout << "endgame search depth " << TEST_DEPTH << ": " << total_nodes << " nodes, "
+            << total_nodes * 1000000 / MAX(1, total_time) << " nps" << std::endl;
+}
+
+int main() {
+    magic::init();
+    std::cout << "%SUITE_STARTING% test_endgame" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% testDispatch (test_endgame)\n" << std::endl;
+    testDispatch();
+    std::cout << "%TEST_FINISHED% time=0 testDispatch (test_endgame)" << std::endl;
+
+    std::cout << "%TEST_STARTED% testBenchmark (test_endgame)\n" << std::endl;
+    testBenchmark();
+    std::cout << "%TEST_FINISHED% time=0 testBenchmark (test_endgame)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
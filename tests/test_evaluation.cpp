@@ -21,6 +21,7 @@
  */
 
 #include "engine.h"
+#include "eval_material.h"
 
 /*
  * Simple C++ Test Suite
@@ -61,6 +62,43 @@ void testEvaluationSuite() {
     
 }
 
+/**
+ * The direct material table gives the same entries as a calculation from the 
+ * piece counts. Promoted pieces out of its range use the material hash table.
+ */
+void testMaterialTable() {
+    const char * fens[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "8/8/8/4k3/8/8/2R5/4K2r b - - 0 1",
+        "8/8/8/2k5/8/8/3p4/K2R4 w - - 0 1",
+        "6k1/5ppp/8/8/8/8/5PPP/2B1B1K1 w - - 0 1",
+        "4k3/8/8/8/8/8/8/NNNNK3 w - - 0 1", //promoted knights
+        "QQ2k3/8/8/8/8/8/8/4K3 w - - 0 1", //promoted queen
+        NULL
+    };
+    for (int i = 0; fens[i]; i++) {
+        search_t * s = new search_t(fens[i]);
+        int n[BKING + 1] = {0};
+        for (int pc = WPAWN; pc <= BQUEEN; pc++) {
+            n[pc] = s->brd.count(pc);
+        }
+        material_table::entry_t expected;
+        material::calculate(&expected, n);
+        int score = material::eval(s);
+        material_table::entry_t * e = s->stack->mt;
+        bool hashed = e->key == s->brd.stack->material_hash;
+        if (score != expected.score || e->phase != expected.phase || e->flags != expected.flags
+                || e->attack_force[WHITE] != expected.attack_force[WHITE]
+                || e->attack_force[BLACK] != expected.attack_force[BLACK]
+                || e->endgame[WHITE] != expected.endgame[WHITE] || e->endgame[BLACK] != expected.endgame[BLACK]
+                || hashed != (i >= 4)) {
+            std::cout << "%TEST_FAILED% time=0 testname=testMaterialTable (evaluation_test) message=" 
+                    << fens[i] << std::endl;
+        }
+        delete s;
+    }
+}
+
 int main() {
     std::cout << "%SUITE_STARTING% evaluation_test" << std::endl;
     std::cout << "%SUITE_STARTED%" << std::endl;
@@ -71,6 +109,9 @@ int main() {
     engine::settings()->max_depth = 20;
     testEvaluationSuite();
     std::cout << "%TEST_FINISHED% time=0 test1 (evaluation_test)" << std::endl;
+    std::cout << "%TEST_STARTED% testMaterialTable (evaluation_test)" << std::endl;
+    testMaterialTable();
+    std::cout << "%TEST_FINISHED% time=0 testMaterialTable (evaluation_test)" << std::endl;
     std::cout << "%SUITE_FINISHED% time=0" << std::endl;
     return (EXIT_SUCCESS);
 }
@@ -95,7 +95,7 @@ bool flip_test(int test_num, const char * fen, int divide_steps = MAX_DIVIDE_STE
 
     global_engine->new_game(brd.to_string());
     global_engine->think();
-    global_engine->stop_all();
+    global_engine->wait();
     //int nodes1 = global_engine->get_total_nodes();
     score1 = global_engine->get_score();
 
@@ -103,7 +103,7 @@ bool flip_test(int test_num, const char * fen, int divide_steps = MAX_DIVIDE_STE
 
     global_engine->new_game(brd.to_string());
     global_engine->think();
-    global_engine->stop_all();
+    global_engine->wait();
     //int nodes2 = global_engine->get_total_nodes();
     score2 = global_engine->get_score();
 
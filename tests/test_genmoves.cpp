@@ -46,7 +46,9 @@ U64 moveGenerationPerft(search_t *s, int depth) {
     move::gen_promotions(pos, move_list);
     move::gen_castles(pos, move_list);
     move::gen_quiet_moves(pos, move_list);
-    for (move_t * move = move_list->first; move != move_list->last; move++) {
+    for (int i = move_list->first; i != move_list->last; i++) {
+        move_t * move = &move_list->move;
+        move_list->get(pos, i, move);
         if (pos->legal(move)) {
             if (depth <= 1) {
                 result += 1;
@@ -72,7 +74,9 @@ void movePerftDivide(search_t * s, int depth) {
     move::gen_promotions(pos, move_list);
     move::gen_castles(pos, move_list);
     move::gen_quiet_moves(pos, move_list);
-    for (move_t * move = move_list->first; move != move_list->last; move++) {
+    for (int i = move_list->first; i != move_list->last; i++) {
+        move_t * move = &move_list->move;
+        move_list->get(pos, i, move);
         std::cout << move->to_string() << " ";
         if (pos->legal(move)) {
             pos->forward(move);
@@ -0,0 +1,130 @@
+/**
+ * Maxima, a chess playing program. 
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma 
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *  
+ * File:   test_latency.cpp
+ * Worker pool: go-to-first-info latency benchmark
+ * Time manager: stop latency after the time is up
+ */
+
+#include "engine.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+const int TEST_RUNS = 200;
+const int STOP_RUNS = 10;
+const int MOVE_TIME = 50; //ms
+
+const char * TEST_POSITION = "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R w KQ - 0 8";
+
+/**
+ * Time a depth 1 search, which is over as soon as the first info line is sent
+ * @return wall clock time in microseconds
+ */
+double go_latency() {
+    engine_t * engine = engine::instance();
+    engine->settings()->clear();
+    engine->settings()->max_depth = 1;
+    engine->set_position(TEST_POSITION);
+    const int64_t begin = time_man::now();
+    engine->think();
+    engine->wait();
+    double result = time_man::now() - begin;
+    if (engine->get_move().piece == 0) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_latency (test_latency) message=no best move" << std::endl;
+    }
+    return result;
+}
+
+void test_latency() {
+    magic::init();
+    uci::silent(true);
+    const int max_threads = MAX(2, engine::instance()->cpu_count());
+    std::cout << "threads | first (us) | mean (us) |  max (us)\n";
+    std::cout << "--------+------------+-----------+----------\n";
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        options::get_option("Threads")->value = threads;
+        double first = go_latency();
+        double total = 0;
+        double max = 0;
+        for (int i = 0; i < TEST_RUNS; i++) {
+            double elapsed = go_latency();
+            total += elapsed;
+            max = MAX(max, elapsed);
+        }
+        std::cout << std::setw(7) << threads << " | ";
+        std::cout << std::setw(10) << int(first) << " | ";
+        std::cout << std::setw(9) << int(total / TEST_RUNS) << " | ";
+        std::cout << std::setw(8) << int(max) << std::endl;
+    }
+    options::get_option("Threads")->value = 1;
+    uci::silent(false);
+}
+
+/**
+ * Time searches with a fixed time per move; the time spent beyond the move 
+ * time is the latency of the time manager and of stopping all threads
+ */
+void test_stop_latency() {
+    uci::silent(true);
+    engine_t * engine = engine::instance();
+    const int max_threads = MAX(2, engine->cpu_count());
+    std::cout << "threads | mean overshoot (ms) | max overshoot (ms)\n";
+    std::cout << "--------+---------------------+-------------------\n";
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        options::get_option("Threads")->value = threads;
+        double total = 0;
+        double max = 0;
+        for (int i = 0; i < STOP_RUNS; i++) {
+            engine->settings()->clear();
+            engine->settings()->max_time_per_move = MOVE_TIME;
+            engine->set_position(TEST_POSITION);
+            const int64_t begin = time_man::now();
+            engine->think();
+            engine->wait();
+            double overshoot = (time_man::now() - begin) / 1000.0 - MOVE_TIME;
+            total += overshoot;
+            max = MAX(max, overshoot);
+            if (engine->get_move().piece == 0) {
+                std::cout << "%TEST_FAILED% time=0 testname=test_stop_latency (test_latency) message=no best move" << std::endl;
+            }
+        }
+        std::cout << std::setw(7) << threads << " | ";
+        std::cout << std::setw(19) << total / STOP_RUNS << " | ";
+        std::cout << std::setw(18) << max << std::endl;
+    }
+    options::get_option("Threads")->value = 1;
+    uci::silent(false);
+}
+
+int main() {
+    std::cout << "%SUITE_STARTING% test_latency" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_latency (test_latency)\n" << std::endl;
+    test_latency();
+    std::cout << "%TEST_FINISHED% time=0 test_latency (test_latency)" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_stop_latency (test_latency)\n" << std::endl;
+    test_stop_latency();
+    std::cout << "%TEST_FINISHED% time=0 test_stop_latency (test_latency)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
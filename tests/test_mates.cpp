@@ -57,7 +57,7 @@ void test_fen(std::string fen, std::string move, int expected_score) {
     engine->new_game(brd.to_string());
     std::cout << tested + 1 << ") " << brd.to_string() << " bm " << bm.to_string();
     engine->think();
-    engine->stop_all();
+    engine->wait();
     bool solved = engine->target_found();
     test_results[tested].fen = fen;
     test_results[tested].solved = solved;
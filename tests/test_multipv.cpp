@@ -0,0 +1,81 @@
+/**
+ * Maxima, a chess playing program.
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *
+ * File:   test_multipv.cpp
+ * Multi-PV: the K best root moves are searched in one iterative deepening loop
+ */
+
+#include "engine.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+const int TEST_DEPTH = 7;
+const int TEST_LINES = 3;
+
+void testMultiPV() {
+    options::get_option("MultiPV")->value = TEST_LINES;
+    game_t game;
+    game.max_depth = TEST_DEPTH;
+    search_t * s = new search_t("4k3/8/8/3q4/8/2N5/8/4K3 w - - 0 1", &game); //Nxd5 wins the queen
+    s->init_root_moves();
+    s->iterative_deepening();
+    for (int i = 0; i < TEST_LINES; i++) {
+        pv_line_t * line = &s->root.lines[i];
+        if (line->depth != TEST_DEPTH || line->pv_count == 0) {
+            std::cout << "%TEST_FAILED% time=0 testname=testMultiPV (test_multipv) message=line "
+                    << i + 1 << " not searched" << std::endl;
+            return;
+        }
+        for (int j = 0; j < i; j++) {
+            if (line->pv_moves[0] == s->root.lines[j].pv_moves[0]) {
+                move_t duplicate;
+                duplicate.set(&s->brd, line->pv_moves[0]);
+                std::cout << "%TEST_FAILED% time=0 testname=testMultiPV (test_multipv) message=duplicate move "
+                        << duplicate.to_string() << std::endl;
+            }
+        }
+    }
+    pv_line_t * lines = s->root.lines;
+    move_t best;
+    best.set(&s->brd, lines[0].pv_moves[0]);
+    if (best.to_string() != "c3d5" || !s->stack->best_move.equals(&best)) {
+        std::cout << "%TEST_FAILED% time=0 testname=testMultiPV (test_multipv) message=best move "
+                << best.to_string() << std::endl;
+    }
+    if (lines[0].score <= lines[1].score || lines[1].score < lines[2].score || s->result_score != lines[0].score) {
+        std::cout << "%TEST_FAILED% time=0 testname=testMultiPV (test_multipv) message=scores "
+                << lines[0].score << " " << lines[1].score << " " << lines[2].score << std::endl;
+    }
+    options::get_option("MultiPV")->value = 1;
+    delete s;
+}
+
+int main() {
+    magic::init();
+    std::cout << "%SUITE_STARTING% test_multipv" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% testMultiPV (test_multipv)\n" << std::endl;
+    testMultiPV();
+    std::cout << "%TEST_FINISHED% time=0 testMultiPV (test_multipv)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
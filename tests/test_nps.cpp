@@ -0,0 +1,88 @@
+/**
+ * Maxima, a chess playing program. 
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma 
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *  
+ * File:   test_nps.cpp
+ * Single threaded search speed (nodes per second) on a fixed position set
+ */
+
+#include "engine.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+const int TEST_DEPTH = 11;
+
+const char * TEST_POSITIONS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R w KQ - 0 8",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r5r1/p1q2p1k/1p1R2pB/3pP3/6bQ/2p5/P1P1NPPP/6K1 w - - 0 1",
+    "2r2rk1/1bqnbpp1/1p1ppn1p/pP6/N1P1P3/P2B1N1P/1B2QPP1/R2R2K1 b - - 0 1",
+    "8/8/4kpp1/3p1b2/p6P/2B5/6P1/6K1 b - - 0 1",
+    "r1b2rk1/2q1b1pp/p2ppn2/1p6/3QP3/1BN1B3/PPP3PP/R4RK1 w - - 0 1"
+};
+
+void test_nps() {
+    magic::init();
+    uci::silent(true);
+    engine_t * engine = engine::instance();
+    options::get_option("Threads")->value = 1;
+    const int count = sizeof (TEST_POSITIONS) / sizeof (TEST_POSITIONS[0]);
+    U64 total_nodes = 0;
+    double total_time = 0;
+    std::cout << "depth " << TEST_DEPTH << "\n\n";
+    std::cout << "pos |      nodes |   time (s) |       nps\n";
+    std::cout << "----+------------+------------+----------\n";
+    for (int i = 0; i < count; i++) {
+        engine->settings()->clear();
+        engine->settings()->max_depth = TEST_DEPTH;
+        engine->new_game(TEST_POSITIONS[i]);
+        const int64_t begin = time_man::now();
+        engine->think();
+        engine->wait();
+        double elapsed = (time_man::now() - begin) / 1000000.0;
+        U64 nodes = engine->get_total_nodes();
+        if (engine->get_move().piece == 0) {
+            std::cout << "%TEST_FAILED% time=0 testname=test_nps (test_nps) message=no best move: "
+                    << TEST_POSITIONS[i] << std::endl;
+        }
+        total_nodes += nodes;
+        total_time += elapsed;
+        std::cout << std::setw(3) << i + 1 << " | ";
+        std::cout << std::setw(10) << nodes << " | ";
+        std::cout << std::setw(10) << elapsed << " | ";
+        std::cout << std::setw(9) << U64(nodes / MAX(0.001, elapsed)) << std::endl;
+    }
+    std::cout << "all | " << std::setw(10) << total_nodes << " | " << std::setw(10) << total_time << " | ";
+    std::cout << std::setw(9) << U64(total_nodes / MAX(0.001, total_time)) << std::endl;
+    uci::silent(false);
+}
+
+int main() {
+    std::cout << "%SUITE_STARTING% test_nps" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_nps (test_nps)\n" << std::endl;
+    test_nps();
+    std::cout << "%TEST_FINISHED% time=0 test_nps (test_nps)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
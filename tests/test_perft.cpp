@@ -0,0 +1,176 @@
+/**
+ * Maxima, a chess playing program.
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *
+ * File:   test_perft.cpp
+ * Perft benchmark of the legal move generation with pins and check evasions
+ * and of the parallel, hashed perft command. The 16 bit move encoding is
+ * tested on the same positions.
+ */
+
+#include "engine.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+/**
+ * Perft with legal moves, using the evasion generator when in check
+ */
+U64 perftLegal(search_t * s, int depth) {
+    U64 result = 0;
+    board_t * pos = &s->brd;
+    move::list_t * list = &s->stack->move_list;
+    list->clear();
+    if (pos->in_check()) {
+        move::gen_evasions(pos, list);
+    } else {
+        move::gen_captures(pos, list);
+        move::gen_promotions(pos, list);
+        move::gen_castles(pos, list);
+        move::gen_quiet_moves(pos, list);
+    }
+    for (int i = list->first; i != list->last; i++) {
+        move_t * move = &list->move;
+        list->get(pos, i, move);
+        assert(pos->legal(move));
+        if (depth <= 1) {
+            result++;
+        } else {
+            pos->forward(move);
+            s->stack++;
+            result += perftLegal(s, depth - 1);
+            s->stack--;
+            pos->backward(move);
+        }
+    }
+    return result;
+}
+
+struct perft_position_t {
+    const char * fen;
+    int depth;
+    U64 nodes;
+};
+
+const perft_position_t POSITIONS[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+    {"8/8/8/2k5/3Pp3/8/8/4K2Q b - d3 0 1", 4, 24199}, //en-passant evasion, counted by the pseudo-legal generators
+    {NULL, 0, 0}
+};
+
+void testPerft() {
+    search_t * s = new search_t(POSITIONS[0].fen);
+    int64_t legal_time = 0; //microseconds
+    U64 total = 0;
+    for (int i = 0; POSITIONS[i].fen; i++) {
+        const perft_position_t & p = POSITIONS[i];
+        s->brd.init(p.fen);
+        int64_t begin = time_man::now();
+        U64 legal = perftLegal(s, p.depth);
+        legal_time += time_man::now() - begin;
+        total += legal;
+        if (legal != p.nodes) {
+            std::cout << "%TEST_FAILED% time=0 testname=testPerft (test_perft) message=" << p.fen
+                    << " nodes " << legal << ", expected " << p.nodes << std::endl;
+        }
+    }
+    std::cout << "nodes: " << total << std::endl;
+    std::cout << "legal generation + evasions: " << legal_time / 1000 << " ms, "
+            << total * 1000 / (legal_time + 1) << " knps" << std::endl;
+    delete s;
+}
+
+/**
+ * Decodes all legal moves from their 16 bit list entries and compares them to
+ * the same moves parsed from strings
+ */
+int encodingErrors(search_t * s, int depth) {
+    int result = 0;
+    board_t * pos = &s->brd;
+    move::list_t * list = &s->stack->move_list;
+    list->clear();
+    move::gen_evasions(pos, list);
+    for (int i = list->first; i != list->last; i++) {
+        move_t * move = &list->move;
+        list->get(pos, i, move);
+        move_t parsed;
+        parsed.set(pos, move->to_string().c_str());
+        if (move->to_int() != list->moves[i] || !parsed.equals(move) || parsed.capture != move->capture
+                || parsed.castle != move->castle || parsed.en_passant != move->en_passant) {
+            std::cout << "encoding error " << move->to_string() << " " << parsed.to_string() << std::endl;
+            result++;
+        } else if (depth > 1) {
+            pos->forward(move);
+            s->stack++;
+            result += encodingErrors(s, depth - 1);
+            s->stack--;
+            pos->backward(move);
+        }
+    }
+    return result;
+}
+
+void testMoveEncoding() {
+    search_t * s = new search_t(POSITIONS[0].fen);
+    for (int i = 0; POSITIONS[i].fen; i++) {
+        s->brd.init(POSITIONS[i].fen);
+        if (encodingErrors(s, 3) > 0) {
+            std::cout << "%TEST_FAILED% time=0 testname=testMoveEncoding (test_perft) message="
+                    << POSITIONS[i].fen << std::endl;
+        }
+    }
+    delete s;
+}
+
+void testParallelPerft() {
+    for (int i = 0; POSITIONS[i].fen; i++) {
+        const perft_position_t & p = POSITIONS[i];
+        engine::new_game(p.fen);
+        U64 hashed = engine::perft(p.depth, 4, 16);
+        U64 unhashed = engine::perft(p.depth, 3, 0);
+        if (hashed != p.nodes || unhashed != p.nodes) {
+            std::cout << "%TEST_FAILED% time=0 testname=testParallelPerft (test_perft) message=" << p.fen
+                    << " hashed " << hashed << " unhashed " << unhashed << std::endl;
+        }
+    }
+}
+
+int main() {
+    magic::init();
+    std::cout << "%SUITE_STARTING% test_perft" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% testPerft (test_perft)\n" << std::endl;
+    testPerft();
+    std::cout << "%TEST_FINISHED% time=0 testPerft (test_perft)" << std::endl;
+
+    std::cout << "%TEST_STARTED% testMoveEncoding (test_perft)\n" << std::endl;
+    testMoveEncoding();
+    std::cout << "%TEST_FINISHED% time=0 testMoveEncoding (test_perft)" << std::endl;
+
+    std::cout << "%TEST_STARTED% testParallelPerft (test_perft)\n" << std::endl;
+    testParallelPerft();
+    std::cout << "%TEST_FINISHED% time=0 testParallelPerft (test_perft)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
@@ -159,6 +159,68 @@ void testPolyglotKeys() {
 
 }
 
+/**
+ * Writes a book entry as 16 big-endian bytes
+ */
+void write_entry(FILE * f, U64 key, int move, int weight) {
+    unsigned char buf[16];
+    memset(buf, 0, sizeof (buf));
+    for (int i = 0; i < 8; i++) {
+        buf[i] = (key >> (56 - 8 * i)) & 255;
+    }
+    buf[8] = (move >> 8) & 255;
+    buf[9] = move & 255;
+    buf[10] = (weight >> 8) & 255;
+    buf[11] = weight & 255;
+    fwrite(buf, 1, sizeof (buf), f);
+}
+
+/**
+ * Finds moves in two small generated (memory mapped) books, open at the same time
+ */
+void testBookFind() {
+    const U64 start_key = C64(0x463b96181691fc9c);
+    const U64 e4_key = C64(0x823c9b50fd114196);
+    FILE * f = fopen("test_polyglot_1.bin", "wb");
+    write_entry(f, C64(0x0000000000000001), 0, 1);
+    write_entry(f, start_key, d4 | (d2 << 6), 1);
+    write_entry(f, start_key, e4 | (e2 << 6), 3);
+    write_entry(f, e4_key, e5 | (e7 << 6), 5);
+    write_entry(f, C64(0xF000000000000000), 0, 1);
+    fclose(f);
+    f = fopen("test_polyglot_2.bin", "wb");
+    write_entry(f, start_key, c4 | (c2 << 6), 7);
+    fclose(f);
+
+    board_t board;
+    board.init("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    move::list_t list;
+    book_t * book1 = book::get("test_polyglot_1.bin");
+    book_t * book2 = book::get("test_polyglot_2.bin");
+    if (book1 == NULL || book2 == NULL || book1 == book2 || book::get("test_polyglot_1.bin") != book1) {
+        std::cout << "%TEST_FAILED% time=0 testname=testBookFind (test_polyglot) message=book registry" << std::endl;
+        return;
+    }
+    int total = book1->find(&board, &list);
+    if (total != 4 || list.last - list.first != 2 || list.moves[list.first] != move::encode(d2, d4)) {
+        std::cout << "%TEST_FAILED% time=0 testname=testBookFind (test_polyglot) message=start position in book 1" << std::endl;
+    }
+    total = book2->find(&board, &list);
+    if (total != 7 || list.last - list.first != 1 || list.moves[list.first] != move::encode(c2, c4)) {
+        std::cout << "%TEST_FAILED% time=0 testname=testBookFind (test_polyglot) message=start position in book 2" << std::endl;
+    }
+    board.init("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1");
+    total = book1->find(&board, &list);
+    if (total != 5 || list.moves[list.first] != move::encode(e7, e5)) {
+        std::cout << "%TEST_FAILED% time=0 testname=testBookFind (test_polyglot) message=position after e2e4" << std::endl;
+    }
+    if (book2->find(&board, &list) != 0 || book::get("no_such_book.bin")->find(&board, &list) != 0) {
+        std::cout << "%TEST_FAILED% time=0 testname=testBookFind (test_polyglot) message=unexpected book hit" << std::endl;
+    }
+    remove("test_polyglot_1.bin");
+    remove("test_polyglot_2.bin");
+}
+
 int main() {
     
     time_t begin;
@@ -178,6 +240,10 @@ int main() {
     time(&now);
     std::cout << "%TEST_FINISHED% time=0 testPolyglotKeys (test_polyglot)" << std::endl;
 
+    std::cout << "%TEST_STARTED% testBookFind (test_polyglot)" << std::endl;
+    testBookFind();
+    std::cout << "%TEST_FINISHED% time=0 testBookFind (test_polyglot)" << std::endl;
+
     std::cout << "%SUITE_FINISHED% time=" << difftime(now, begin) << std::endl;
 
     return (EXIT_SUCCESS);
@@ -0,0 +1,99 @@
+/**
+ * Maxima, a chess playing program. 
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma 
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *  
+ * File:   test_smp.cpp
+ * Lazy SMP: time-to-depth scaling benchmark for 1..N threads
+ */
+
+#include "engine.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+const int TEST_DEPTH = 10;
+
+const char * TEST_POSITIONS[] = {
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N2N2/PP2BPPP/R2QKB1R w KQ - 0 8",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r5r1/p1q2p1k/1p1R2pB/3pP3/6bQ/2p5/P1P1NPPP/6K1 w - - 0 1"
+};
+
+/**
+ * Search all test positions to a fixed depth with a given amount of threads
+ * @param threads amount of search threads
+ * @param nodes total amount of nodes searched (output)
+ * @return wall clock time in seconds
+ */
+double time_to_depth(int threads, U64 & nodes) {
+    engine_t * engine = engine::instance();
+    options::get_option("Threads")->value = threads;
+    nodes = 0;
+    const int count = sizeof (TEST_POSITIONS) / sizeof (TEST_POSITIONS[0]);
+    const int64_t begin = time_man::now();
+    for (int i = 0; i < count; i++) {
+        engine->settings()->clear();
+        engine->settings()->max_depth = TEST_DEPTH;
+        engine->new_game(TEST_POSITIONS[i]);
+        engine->think();
+        engine->wait();
+        nodes += engine->get_total_nodes();
+        if (engine->get_move().piece == 0) {
+            std::cout << "%TEST_FAILED% time=0 testname=test_smp (test_smp) message=no best move with "
+                    << threads << " threads: " << TEST_POSITIONS[i] << std::endl;
+        }
+    }
+    return (time_man::now() - begin) / 1000000.0;
+}
+
+void test_smp() {
+    magic::init();
+    uci::silent(true);
+    const int max_threads = MAX(2, engine::instance()->cpu_count());
+    double base = 0;
+    std::cout << "depth " << TEST_DEPTH << "\n\n";
+    std::cout << "threads |   time (s) |      nodes |       nps | speedup\n";
+    std::cout << "--------+------------+------------+-----------+--------\n";
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        U64 nodes;
+        double elapsed = time_to_depth(threads, nodes);
+        if (threads == 1) {
+            base = elapsed;
+        }
+        std::cout << std::setw(7) << threads << " | ";
+        std::cout << std::setw(10) << elapsed << " | ";
+        std::cout << std::setw(10) << nodes << " | ";
+        std::cout << std::setw(9) << U64(nodes / MAX(0.001, elapsed)) << " | ";
+        std::cout << std::setw(6) << base / MAX(0.001, elapsed) << std::endl;
+    }
+    options::get_option("Threads")->value = 1;
+    uci::silent(false);
+}
+
+int main() {
+    std::cout << "%SUITE_STARTING% test_smp" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_smp (test_smp)\n" << std::endl;
+    test_smp();
+    std::cout << "%TEST_FINISHED% time=0 test_smp (test_smp)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
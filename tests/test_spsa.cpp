@@ -0,0 +1,77 @@
+/**
+ * Maxima, a chess playing program.
+ * Copyright (C) 1996-2015 Erik van het Hof and Hermen Reitsma
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, If not, see <http://www.gnu.org/licenses/>.
+ *
+ * File:   test_spsa.cpp
+ * SPSA tuner: parameter file checkpoints and update direction
+ */
+
+#include <cstdio>
+#include <fstream>
+#include "engine.h"
+
+/*
+ * Simple C++ Test Suite
+ */
+
+const char * PARAM_FILE = "test_spsa.txt";
+
+void testCheckpoint() {
+    std::ofstream file(PARAM_FILE);
+    file << "iterations 100\npairs 4\n# comment\nKingAttackShelter 256 0 512 20 0.002\n"
+            << "DrawContempt -200 -100 100 5 0.002\n";
+    file.close();
+    spsa_t spsa;
+    search_t * s = new search_t("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    if (!spsa.load(PARAM_FILE) || spsa.count != 2 || spsa.iteration != 0 || spsa.pairs != 4) {
+        std::cout << "%TEST_FAILED% time=0 testname=testCheckpoint (test_spsa) message=load failed" << std::endl;
+    } else if (spsa.params[1].value != -100) {
+        std::cout << "%TEST_FAILED% time=0 testname=testCheckpoint (test_spsa) message=value not clamped" << std::endl;
+    } else if (s->param(spsa.params[0].name) != &s->king_attack_shelter || s->param("NoSuchParam") != NULL) {
+        std::cout << "%TEST_FAILED% time=0 testname=testCheckpoint (test_spsa) message=param lookup" << std::endl;
+    }
+    int plus[MAX_SPSA_PARAMS], minus[MAX_SPSA_PARAMS];
+    spsa.perturb(plus, minus);
+    if ((plus[0] - 256) * spsa.flip[0] <= 0 || plus[0] + minus[0] != 512) {
+        std::cout << "%TEST_FAILED% time=0 testname=testCheckpoint (test_spsa) message=perturb "
+                << plus[0] << " " << minus[0] << std::endl;
+    }
+    spsa.update(4); //plus vector won
+    if ((spsa.params[0].value - 256) * spsa.flip[0] <= 0 || spsa.iteration != 1) {
+        std::cout << "%TEST_FAILED% time=0 testname=testCheckpoint (test_spsa) message=update "
+                << spsa.params[0].value << std::endl;
+    }
+    spsa_t resumed;
+    if (!spsa.save(PARAM_FILE) || !resumed.load(PARAM_FILE) || resumed.iteration != 1
+            || resumed.count != 2 || std::abs(resumed.params[0].value - spsa.params[0].value) > 1e-6) {
+        std::cout << "%TEST_FAILED% time=0 testname=testCheckpoint (test_spsa) message=resume failed" << std::endl;
+    }
+    remove(PARAM_FILE);
+    delete s;
+}
+
+int main() {
+    std::cout << "%SUITE_STARTING% test_spsa" << std::endl;
+    std::cout << "%SUITE_STARTED%" << std::endl;
+
+    std::cout << "%TEST_STARTED% testCheckpoint (test_spsa)\n" << std::endl;
+    testCheckpoint();
+    std::cout << "%TEST_FINISHED% time=0 testCheckpoint (test_spsa)" << std::endl;
+
+    std::cout << "%SUITE_FINISHED% time=0" << std::endl;
+
+    return (EXIT_SUCCESS);
+}
@@ -40,7 +40,7 @@ void test_tt() {
 
     search_t * s = new search_t("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
     evaluate(s);
-    pawn_table::entry_t * pe = pawn_table::retrieve(s->brd.stack->pawn_hash);
+    pawn_table::entry_t * pe = s->ptable->retrieve(s->brd.stack->pawn_hash);
 
     //pawn entry should contain valid information for the starting position
     if (pe->key != s->brd.stack->pawn_hash
@@ -59,7 +59,7 @@ void test_tt() {
      */
 
     U64 key = s->brd.stack->material_hash;
-    material_table::entry_t * me = material_table::retrieve(key);   
+    material_table::entry_t * me = s->mtable->retrieve(key);   
 
     //check for valid entry
     if (me->key != key
@@ -78,13 +78,13 @@ void test_tt() {
     int age = 1;
     int ply = 2;
     int depth = 10;
-    int score, move, flag;
+    int score, move, flag, eval;
     U64 keys[4] = {0x1000000123, 0x2000000123, 0x3000000123, 0x4000000123};
     for (int i = 0; i < 4; i++) { //test all buckets
-        trans_table::store(keys[i], age, ply, depth, i + 10, i + 100, 3);
+        trans_table::store(keys[i], age, ply, depth, i + 10, i + 100, 3, score::INVALID, 0);
     }
     for (int i = 0; i < 4; i++) {
-        bool result = trans_table::retrieve(keys[i], ply, depth, score, move, flag);
+        bool result = trans_table::retrieve(keys[i], ply, depth, score, move, flag, eval, 0);
         if (result == false
                 || score != i + 10
                 || move != i + 100
@@ -95,9 +95,9 @@ void test_tt() {
     }
 
     move_t * tmove = move::first(s, 0);
-    trans_table::store(s->brd.stack->tt_key, s->brd.root_ply, s->brd.ply, 123, -12345, tmove->to_int(), 3);
+    trans_table::store(s->brd.stack->tt_key, s->brd.root_ply, s->brd.ply, 123, -12345, tmove->to_int(), 3, score::INVALID, 0);
 
-    bool result = trans_table::retrieve(s->brd.stack->tt_key, s->brd.ply, 123, score, move, flag);
+    bool result = trans_table::retrieve(s->brd.stack->tt_key, s->brd.ply, 123, score, move, flag, eval, 0);
 
 
     if (result == false
@@ -119,7 +119,7 @@ void test_tt() {
     engine::settings()->max_depth = 15;
     engine->new_game("8/k7/3p4/p2P1p2/P2P1P2/8/8/K7 w - -");
     engine->think();
-    engine->stop_all();
+    engine->wait();
 
     if (engine->get_total_nodes() > 50000) {
         std::cout << "%TEST_FAILED% time=0 testname=test_tt (test_transpositiontable) message=hashtable not effective" << std::endl;
@@ -127,6 +127,171 @@ void test_tt() {
     delete s;
 }
 
+/*
+ * The static evaluation is stored with the entry, INVALID if none was given
+ */
+void test_tt_eval() {
+    std::cout << "test_transpositiontable test tt eval" << std::endl;
+    trans_table_t * table = new trans_table_t(1);
+    const U64 key = 0x1000000123;
+    int score, move, flag, eval;
+    table->store(key, 1, 0, 10, 25, 100, 3, -123, 0);
+    if (!table->retrieve(key, 0, 10, score, move, flag, eval, 0) || eval != -123 || score != 25 || move != 100) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_tt_eval (test_transpositiontable) message=eval store/retrieve error" << std::endl;
+    }
+    table->store(key, 1, 0, 10, 25, 100, 3, score::INVALID, 0);
+    if (!table->retrieve(key, 0, 10, score, move, flag, eval, 0) || eval != score::INVALID) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_tt_eval (test_transpositiontable) message=eval not invalidated" << std::endl;
+    }
+    delete table;
+}
+
+/*
+ * Counters are kept per thread and summed; hashfull counts the entries of 
+ * the current search only
+ */
+void test_tt_stats() {
+    std::cout << "test_transpositiontable test tt stats" << std::endl;
+    trans_table_t * table = new trans_table_t(1);
+    int score, move, flag, eval;
+    for (U64 i = 1; i <= 5; i++) { //same bucket, the fifth store replaces an entry
+        table->store(i << 32, 1, 0, 10, 25, 100, 3, score::INVALID, i % 2);
+    }
+    table->retrieve(U64(5) << 32, 0, 10, score, move, flag, eval, 1);
+    table->retrieve(U64(6) << 32, 0, 10, score, move, flag, eval, 0);
+    hash_stats_t stats;
+    table->stats(stats);
+    if (stats.stores != 5 || stats.overwrites != 1 || stats.probes != 2 || stats.hits != 1 || stats.collisions != 1) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_tt_stats (test_transpositiontable) message=counters "
+                << stats.stores << " " << stats.overwrites << " " << stats.probes << " "
+                << stats.hits << " " << stats.collisions << std::endl;
+    }
+    if (table->hashfull(1) != 4 || table->hashfull(2) != 0) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_tt_stats (test_transpositiontable) message=hashfull "
+                << table->hashfull(1) << std::endl;
+    }
+    table->clear();
+    table->stats(stats);
+    if (stats.probes != 0 || table->hashfull(1) != 0) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_tt_stats (test_transpositiontable) message=not cleared" << std::endl;
+    }
+    delete table;
+}
+
+/*
+ * Evaluation cache: scores are found by key only, and evaluate() takes a 
+ * cached score instead of calculating it again
+ */
+void test_eval_cache() {
+    std::cout << "test_transpositiontable test eval cache" << std::endl;
+    eval_cache::table_t * cache = new eval_cache::table_t(1);
+    const U64 key = 0x1000000123;
+    int score = 0;
+    cache->store(key, -123);
+    if (!cache->retrieve(key, score) || score != -123 || cache->retrieve(key ^ C64(0x10000000000), score)) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_eval_cache (test_transpositiontable) message=store/retrieve error" << std::endl;
+    }
+    delete cache;
+
+    const char * fen = "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4";
+    eval_cache::clear();
+    search_t * s1 = new search_t(fen);
+    search_t * s2 = new search_t(fen);
+    int score1 = evaluate(s1);
+    int score2 = evaluate(s2);
+    if (score1 != score2 || s1->evals != 1 || s2->evals != 0 || s2->cached_evals != 1) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_eval_cache (test_transpositiontable) message=cached evaluation "
+                << score1 << " " << score2 << std::endl;
+    }
+    delete s1;
+    delete s2;
+}
+
+/*
+ * Multi-threaded stress test. Every key is always stored with the same move,
+ * score and flag, so any mismatch on a hit means a torn entry was returned.
+ */
+
+const int STRESS_THREADS = 4;
+const int STRESS_KEYS = 4096;
+const int STRESS_OPS = 500000;
+
+struct stress_t {
+    trans_table_t * table;
+    unsigned int seed;
+    int thread_id;
+    int hits;
+    int torn;
+};
+
+U64 stress_key(int i) {
+    U64 key = (U64(i) + 1) * C64(0x9E3779B97F4A7C15);
+    return (key & ~C64(0xFFFF)) | (i % 16); //16 buckets: many writers per bucket
+}
+
+int stress_move(U64 key) {
+    return int((key >> 40) & 0xFFFF) | 1;
+}
+
+int stress_score(U64 key) {
+    return int((key >> 20) & 0x3FF) - 512;
+}
+
+int stress_flag(U64 key) {
+    return 1 + int(key & 1);
+}
+
+void * stress_thread(void * p) {
+    stress_t * t = (stress_t *) p;
+    for (int i = 0; i < STRESS_OPS; i++) {
+        U64 key = stress_key(rand_r(&t->seed) % STRESS_KEYS);
+        if (rand_r(&t->seed) & 1) {
+            int depth = 1 + rand_r(&t->seed) % 60;
+            int age = rand_r(&t->seed) % 64;
+            t->table->store(key, age, 0, depth, stress_score(key), stress_move(key), stress_flag(key), score::INVALID, t->thread_id);
+        } else {
+            int score = 0, move = 0, flag = 0, eval = 0;
+            t->table->retrieve(key, 0, 1, score, move, flag, eval, t->thread_id);
+            if (move != 0) {
+                t->hits++;
+                if (move != stress_move(key) || score != stress_score(key) || flag != stress_flag(key)) {
+                    t->torn++;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+void test_tt_threads() {
+    std::cout << "test_transpositiontable test tt threads" << std::endl;
+    trans_table_t * table = new trans_table_t(1);
+    pthread_t threads[STRESS_THREADS];
+    stress_t data[STRESS_THREADS];
+    for (int i = 0; i < STRESS_THREADS; i++) {
+        data[i].table = table;
+        data[i].seed = i + 1;
+        data[i].thread_id = i;
+        data[i].hits = 0;
+        data[i].torn = 0;
+        pthread_create(&threads[i], NULL, stress_thread, &data[i]);
+    }
+    int hits = 0, torn = 0;
+    for (int i = 0; i < STRESS_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        hits += data[i].hits;
+        torn += data[i].torn;
+    }
+    std::cout << "hits: " << hits << " torn: " << torn << std::endl;
+    if (hits == 0) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_tt_threads (test_transpositiontable) message=no hits" << std::endl;
+    }
+    if (torn > 0) {
+        std::cout << "%TEST_FAILED% time=0 testname=test_tt_threads (test_transpositiontable) message=torn entry returned" << std::endl;
+    }
+    delete table;
+}
+
 int main() {
     std::cout << "%SUITE_STARTING% test_transpositiontable" << std::endl;
     std::cout << "%SUITE_STARTED%" << std::endl;
@@ -135,6 +300,22 @@ int main() {
     test_tt();
     std::cout << "%TEST_FINISHED% time=0 test_tt (test_transpositiontable)" << std::endl;
 
+    std::cout << "%TEST_STARTED% test_tt_eval (test_transpositiontable)\n" << std::endl;
+    test_tt_eval();
+    std::cout << "%TEST_FINISHED% time=0 test_tt_eval (test_transpositiontable)" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_tt_stats (test_transpositiontable)\n" << std::endl;
+    test_tt_stats();
+    std::cout << "%TEST_FINISHED% time=0 test_tt_stats (test_transpositiontable)" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_eval_cache (test_transpositiontable)\n" << std::endl;
+    test_eval_cache();
+    std::cout << "%TEST_FINISHED% time=0 test_eval_cache (test_transpositiontable)" << std::endl;
+
+    std::cout << "%TEST_STARTED% test_tt_threads (test_transpositiontable)\n" << std::endl;
+    test_tt_threads();
+    std::cout << "%TEST_FINISHED% time=0 test_tt_threads (test_transpositiontable)" << std::endl;
+
     std::cout << "%SUITE_FINISHED% time=0" << std::endl;
 
     return (EXIT_SUCCESS);